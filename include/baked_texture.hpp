@@ -0,0 +1,387 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "block_compression.hpp"
+#include "gl_state.hpp"
+#include "mipmap_generator.hpp"
+#include "texture_upload.hpp"
+
+#include "ext/glad/glad.h"
+
+// Baked textures are written offline by the texture_baker tool, so loading one is a matter of
+// mapping the file and handing every mip level straight to glTexImage2D: no decoding and no
+// glGenerateMipmap at runtime. The file is laid out as
+//
+//   BakedTextureHeader
+//   BakedMipLevel[levelCount]
+//   pixel data of each level, starting at BakedMipLevel::offset, rows padded to 4 bytes
+//
+// Compressed textures store rows of 4x4 blocks instead and are uploaded with glCompressedTexImage2D.
+constexpr uint32_t BAKED_TEXTURE_MAGIC = 0x58544F4C; // "LOTX" in little endian
+constexpr uint32_t BAKED_TEXTURE_VERSION = 2;
+constexpr uint32_t BAKED_TEXTURE_ROW_ALIGNMENT = 4;  // Matches the default GL_UNPACK_ALIGNMENT
+constexpr const char* BAKED_TEXTURE_EXTENSION = ".lotex";
+
+enum BakedTextureFlags : uint32_t
+{
+  BAKED_TEXTURE_SRGB = 1 << 0,
+  BAKED_TEXTURE_COMPRESSED = 1 << 1, // internalFormat is a block compressed format, format and type are 0
+};
+
+struct BakedTextureHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width, height;
+  uint32_t levelCount;
+  uint32_t channels;
+  uint32_t internalFormat; // Sized or compressed, e.g. GL_SRGB8_ALPHA8 or GL_COMPRESSED_RED_RGTC1
+  uint32_t format;         // Pixel transfer format, e.g. GL_RGB
+  uint32_t type;           // Pixel transfer type, always GL_UNSIGNED_BYTE for now
+  uint32_t flags;
+};
+
+struct BakedMipLevel
+{
+  uint32_t width, height;
+  uint32_t rowPitch;
+  uint32_t _padding;
+  uint64_t offset, size;
+};
+
+static_assert(sizeof(BakedTextureHeader) == 40 && sizeof(BakedMipLevel) == 32,
+              "Baked texture structs are written to disk as is and must not change size");
+
+// One level as the baking functions see it: rows of rowBytes each, tightly packed
+struct _BakedLevelSource
+{
+  uint32_t width, height;
+  const unsigned char* data;
+  size_t rowBytes;
+  uint32_t rows;
+};
+
+inline std::vector<unsigned char> _writeBakedTexture(const BakedTextureHeader& header,
+                                                     const std::vector<_BakedLevelSource>& levels)
+{
+  std::vector<BakedMipLevel> mipLevels(levels.size());
+  uint64_t offset = sizeof(BakedTextureHeader) + levels.size() * sizeof(BakedMipLevel);
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    const uint32_t rowPitch = (levels[i].rowBytes + BAKED_TEXTURE_ROW_ALIGNMENT - 1) / BAKED_TEXTURE_ROW_ALIGNMENT * BAKED_TEXTURE_ROW_ALIGNMENT;
+    mipLevels[i] = {levels[i].width, levels[i].height, rowPitch, 0, offset, static_cast<uint64_t>(rowPitch) * levels[i].rows};
+    offset += mipLevels[i].size;
+  }
+
+  std::vector<unsigned char> file(offset, 0);
+  std::memcpy(file.data(), &header, sizeof(header));
+  std::memcpy(file.data() + sizeof(header), mipLevels.data(), mipLevels.size() * sizeof(BakedMipLevel));
+  for (size_t i = 0; i < levels.size(); i++)
+  {
+    for (uint32_t y = 0; y < levels[i].rows; y++)
+    {
+      std::memcpy(file.data() + mipLevels[i].offset + static_cast<size_t>(y) * mipLevels[i].rowPitch,
+                  levels[i].data + y * levels[i].rowBytes, levels[i].rowBytes);
+    }
+  }
+  return file;
+}
+
+// Serialises an already generated mip chain into the baked texture format
+inline std::vector<unsigned char> bakeTexture(const std::vector<MipLevel>& levels, const int channels, const bool srgb)
+{
+  const bool applySrgb = srgb && channels >= 3; // There are no one or two channel sRGB formats
+  const BakedTextureHeader header{
+    BAKED_TEXTURE_MAGIC, BAKED_TEXTURE_VERSION,
+    static_cast<uint32_t>(levels[0].width), static_cast<uint32_t>(levels[0].height),
+    static_cast<uint32_t>(levels.size()), static_cast<uint32_t>(channels),
+    sizedInternalFormat(channels, applySrgb), pixelFormat(channels), GL_UNSIGNED_BYTE,
+    applySrgb ? BAKED_TEXTURE_SRGB : 0u,
+  };
+
+  std::vector<_BakedLevelSource> sources;
+  for (const MipLevel& level : levels)
+  {
+    sources.push_back({static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height), level.pixels.data(),
+                       static_cast<size_t>(level.width) * channels, static_cast<uint32_t>(level.height)});
+  }
+  return _writeBakedTexture(header, sources);
+}
+
+// Same for a block compressed mip chain, every level in the same format
+inline std::vector<unsigned char> bakeCompressedTexture(const std::vector<CompressedImage>& levels, const int channels,
+                                                        const bool srgb)
+{
+  const BlockFormat format = levels[0].format;
+  const bool applySrgb = srgb && (format == BlockFormat::BC1 || format == BlockFormat::BC3);
+  const BakedTextureHeader header{
+    BAKED_TEXTURE_MAGIC, BAKED_TEXTURE_VERSION,
+    static_cast<uint32_t>(levels[0].width), static_cast<uint32_t>(levels[0].height),
+    static_cast<uint32_t>(levels.size()), static_cast<uint32_t>(channels),
+    blockInternalFormat(format, applySrgb), 0, 0,
+    BAKED_TEXTURE_COMPRESSED | (applySrgb ? BAKED_TEXTURE_SRGB : 0u),
+  };
+
+  std::vector<_BakedLevelSource> sources;
+  for (const CompressedImage& level : levels)
+  {
+    sources.push_back({static_cast<uint32_t>(level.width), static_cast<uint32_t>(level.height), level.blocks.data(),
+                       blockCount(level.width) * blockBytes(format), static_cast<uint32_t>(blockCount(level.height))});
+  }
+  return _writeBakedTexture(header, sources);
+}
+
+// Read-only memory mapping of a baked texture file. Pages are only read in as glTexImage2D
+// touches them and stay clean, so the kernel can drop them again instead of swapping.
+class BakedTextureFile
+{
+  void* _data = MAP_FAILED;
+  size_t _size = 0;
+
+public:
+  explicit BakedTextureFile(const char* path)
+  {
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+      return;
+
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(BakedTextureHeader))
+    {
+      _size = info.st_size;
+      _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping keeps the file alive on its own
+    close(fd);
+
+    if (valid() && (header().magic != BAKED_TEXTURE_MAGIC || header().version != BAKED_TEXTURE_VERSION ||
+                    !_levelsInBounds()))
+    {
+      std::cout << "ERROR::BAKED_TEXTURE::INVALID_FILE " << path << std::endl;
+      munmap(_data, _size);
+      _data = MAP_FAILED;
+    }
+  }
+
+  ~BakedTextureFile()
+  {
+    if (valid())
+      munmap(_data, _size);
+  }
+
+  BakedTextureFile(const BakedTextureFile&) = delete;
+  BakedTextureFile& operator=(const BakedTextureFile&) = delete;
+
+  [[nodiscard]] bool valid() const { return _data != MAP_FAILED; }
+
+  [[nodiscard]] const BakedTextureHeader& header() const
+  {
+    return *static_cast<const BakedTextureHeader*>(_data);
+  }
+
+  [[nodiscard]] const BakedMipLevel& level(const uint32_t index) const
+  {
+    return reinterpret_cast<const BakedMipLevel*>(static_cast<const unsigned char*>(_data) + sizeof(BakedTextureHeader))[index];
+  }
+
+  [[nodiscard]] const unsigned char* pixels(const uint32_t index) const
+  {
+    return static_cast<const unsigned char*>(_data) + level(index).offset;
+  }
+
+private:
+  [[nodiscard]] bool _levelsInBounds() const
+  {
+    const size_t tableEnd = sizeof(BakedTextureHeader) + static_cast<size_t>(header().levelCount) * sizeof(BakedMipLevel);
+    if (header().levelCount == 0 || tableEnd > _size)
+      return false;
+    for (uint32_t i = 0; i < header().levelCount; i++)
+    {
+      if (level(i).offset + level(i).size > _size)
+        return false;
+    }
+    return true;
+  }
+};
+
+// Defines one level of the bound, mutable GL_TEXTURE_2D from a baked texture file and returns
+// the bytes it occupies on the GPU. Drivers without the block format of a compressed texture get
+// the blocks decoded to RGBA8 on the CPU, which costs the VRAM savings but not the texture.
+inline size_t uploadBakedLevel(const BakedTextureFile& file, const uint32_t index)
+{
+  const BakedTextureHeader& header = file.header();
+  const BakedMipLevel& level = file.level(index);
+  const auto width = static_cast<int>(level.width);
+  const auto height = static_cast<int>(level.height);
+  if (!(header.flags & BAKED_TEXTURE_COMPRESSED))
+  {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, BAKED_TEXTURE_ROW_ALIGNMENT);
+    glTexImage2D(GL_TEXTURE_2D, static_cast<int>(index), static_cast<int>(header.internalFormat), width, height, 0,
+                 header.format, header.type, file.pixels(index));
+    return static_cast<size_t>(width) * height * header.channels;
+  }
+
+  BlockFormat format;
+  if (!blockFormatFromInternal(header.internalFormat, &format))
+  {
+    std::cout << "ERROR::BAKED_TEXTURE::UNKNOWN_COMPRESSED_FORMAT " << header.internalFormat << std::endl;
+    return 0;
+  }
+  if (supportsBlockFormat(format, header.flags & BAKED_TEXTURE_SRGB))
+  {
+    glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<int>(index), header.internalFormat, width, height, 0,
+                           static_cast<int>(level.size), file.pixels(index));
+    return level.size;
+  }
+
+  const GLenum internalFormat = header.flags & BAKED_TEXTURE_SRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  const CompressedImage image{format, width, height,
+                              std::vector<unsigned char>(file.pixels(index), file.pixels(index) + level.size)};
+  const std::vector<unsigned char> pixels = decompressImage(image);
+  glTexImage2D(GL_TEXTURE_2D, static_cast<int>(index), static_cast<int>(internalFormat), width, height, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, pixels.data());
+  return pixels.size();
+}
+
+// Creates a texture from a baked texture file. Returns false if the file is missing or invalid.
+inline bool loadBakedTexture(const char* path, uint* textureId)
+{
+  const BakedTextureFile file(path);
+  if (!file.valid())
+    return false;
+
+  const BakedTextureHeader& header = file.header();
+  glGenTextures(1, textureId);
+  glState().bindTextureForUpdate(GL_TEXTURE_2D, *textureId);
+
+  if (header.flags & BAKED_TEXTURE_COMPRESSED)
+  {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int>(header.levelCount) - 1);
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+      uploadBakedLevel(file, i);
+    }
+    return true;
+  }
+
+  allocateTextureStorage(static_cast<int>(header.levelCount), header.internalFormat, static_cast<int>(header.width),
+                         static_cast<int>(header.height));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, BAKED_TEXTURE_ROW_ALIGNMENT);
+  for (uint32_t i = 0; i < header.levelCount; i++)
+  {
+    const BakedMipLevel& level = file.level(i);
+    glTexSubImage2D(GL_TEXTURE_2D, static_cast<int>(i), 0, 0, static_cast<int>(level.width),
+                    static_cast<int>(level.height), header.format, header.type, file.pixels(i));
+  }
+  return true;
+}
+
+// Creates a GL_TEXTURE_2D_ARRAY with the baked texture file paths[i] as layer i. Returns false if
+// none of the files exist. Layers that are missing, invalid or differ from the first in size,
+// level count or format are reported and make it return false too, one array can't hold them.
+inline bool loadBakedTextureArray(const std::vector<std::string>& paths, uint* textureId)
+{
+  std::vector<std::unique_ptr<BakedTextureFile>> files;
+  size_t validCount = 0;
+  for (const std::string& path : paths)
+  {
+    files.push_back(std::make_unique<BakedTextureFile>(path.c_str()));
+    validCount += files.back()->valid();
+  }
+  if (validCount == 0)
+    return false;
+
+  // Every layer is checked before any header is read, the first one included
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    if (!files[i]->valid())
+    {
+      std::cout << "ERROR::BAKED_TEXTURE::ARRAY_LAYER_NOT_BAKED " << paths[i] << std::endl;
+      return false;
+    }
+  }
+
+  const BakedTextureHeader& header = files[0]->header();
+  for (size_t i = 1; i < files.size(); i++)
+  {
+    const BakedTextureHeader& layer = files[i]->header();
+    if (layer.width != header.width || layer.height != header.height || layer.levelCount != header.levelCount ||
+        layer.internalFormat != header.internalFormat || layer.flags != header.flags)
+    {
+      std::cout << "ERROR::BAKED_TEXTURE::ARRAY_LAYERS_DIFFER " << paths[i] << std::endl;
+      return false;
+    }
+  }
+
+  BlockFormat format{};
+  const bool compressed = header.flags & BAKED_TEXTURE_COMPRESSED;
+  if (compressed && !blockFormatFromInternal(header.internalFormat, &format))
+  {
+    std::cout << "ERROR::BAKED_TEXTURE::UNKNOWN_COMPRESSED_FORMAT " << header.internalFormat << std::endl;
+    return false;
+  }
+
+  const auto layers = static_cast<int>(files.size());
+  const auto levelCount = static_cast<int>(header.levelCount);
+  glGenTextures(1, textureId);
+  glState().bindTextureForUpdate(GL_TEXTURE_2D_ARRAY, *textureId);
+
+  if (compressed && supportsBlockFormat(format, header.flags & BAKED_TEXTURE_SRGB))
+  {
+    // Every layer's blocks of a level back to back, the way glCompressedTexImage3D takes them
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    std::vector<unsigned char> blocks;
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+      blocks.clear();
+      for (const auto& file : files)
+      {
+        blocks.insert(blocks.end(), file->pixels(i), file->pixels(i) + file->level(i).size);
+      }
+      const BakedMipLevel& level = files[0]->level(i);
+      glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<int>(i), header.internalFormat,
+                             static_cast<int>(level.width), static_cast<int>(level.height), layers, 0,
+                             static_cast<int>(blocks.size()), blocks.data());
+    }
+    return true;
+  }
+
+  // Drivers without the block format get the blocks decoded to RGBA8, like uploadBakedLevel does
+  const GLenum internalFormat = !compressed ? header.internalFormat
+                                : header.flags & BAKED_TEXTURE_SRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  allocateTextureArrayStorage(levelCount, internalFormat, static_cast<int>(header.width),
+                              static_cast<int>(header.height), layers);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, BAKED_TEXTURE_ROW_ALIGNMENT);
+  for (int layer = 0; layer < layers; layer++)
+  {
+    const BakedTextureFile& file = *files[layer];
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+      const BakedMipLevel& level = file.level(i);
+      const auto width = static_cast<int>(level.width);
+      const auto height = static_cast<int>(level.height);
+      if (!compressed)
+      {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<int>(i), 0, 0, layer, width, height, 1, header.format,
+                        header.type, file.pixels(i));
+        continue;
+      }
+      const CompressedImage image{format, width, height,
+                                  std::vector<unsigned char>(file.pixels(i), file.pixels(i) + level.size)};
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, static_cast<int>(i), 0, 0, layer, width, height, 1, GL_RGBA,
+                      GL_UNSIGNED_BYTE, decompressImage(image).data());
+    }
+  }
+  return true;
+}
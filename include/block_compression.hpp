@@ -0,0 +1,533 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "gl_extensions.hpp"
+
+#include "ext/glad/glad.h"
+
+typedef unsigned int uint;
+
+// S3TC is an extension rather than core GL, so the loader header doesn't define its formats
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
+// Block compressed formats. Every format encodes 4x4 pixel blocks independently:
+//   BC1 (DXT1):  RGB, two 565 endpoints and 2-bit indices, 8 bytes per block
+//   BC3 (DXT5):  BC1 colour plus a BC4 alpha block, 16 bytes per block
+//   BC4 (RGTC1): one channel, two 8-bit endpoints and 3-bit indices, 8 bytes per block
+//   BC5 (RGTC2): two BC4 blocks for red and green, 16 bytes per block
+enum class BlockFormat
+{
+  BC1,
+  BC3,
+  BC4,
+  BC5,
+};
+
+constexpr int BLOCK_SIZE = 4;
+
+inline size_t blockBytes(const BlockFormat format)
+{
+  return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+// The format that keeps every channel an image has
+inline BlockFormat blockFormatFor(const int channels)
+{
+  switch (channels)
+  {
+    case 1: return BlockFormat::BC4;
+    case 2: return BlockFormat::BC5;
+    case 3: return BlockFormat::BC1;
+    default: return BlockFormat::BC3;
+  }
+}
+
+inline GLenum blockInternalFormat(const BlockFormat format, const bool srgb)
+{
+  switch (format)
+  {
+    case BlockFormat::BC1: return srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BlockFormat::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+    default: return GL_COMPRESSED_RG_RGTC2;
+  }
+}
+
+// Inverse of blockInternalFormat, false if internalFormat isn't one of ours
+inline bool blockFormatFromInternal(const GLenum internalFormat, BlockFormat* format)
+{
+  switch (internalFormat)
+  {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT: *format = BlockFormat::BC1; return true;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT: *format = BlockFormat::BC3; return true;
+    case GL_COMPRESSED_RED_RGTC1: *format = BlockFormat::BC4; return true;
+    case GL_COMPRESSED_RG_RGTC2: *format = BlockFormat::BC5; return true;
+    default: return false;
+  }
+}
+
+// RGTC is core since GL 3.0, S3TC is only there when the driver exposes the extension. The sRGB
+// S3TC formats come from GL_EXT_texture_sRGB on top of it, which core sRGB doesn't imply.
+inline bool supportsBlockFormat(const BlockFormat format, const bool srgb)
+{
+  if (format == BlockFormat::BC4 || format == BlockFormat::BC5)
+    return true;
+  static const bool s3tc = hasGLExtension("GL_EXT_texture_compression_s3tc");
+  static const bool s3tcSrgb = s3tc && hasGLExtension("GL_EXT_texture_sRGB");
+  return srgb ? s3tcSrgb : s3tc;
+}
+
+// One 4x4 block as RGBA8, rows in memory order
+struct BlockPixels
+{
+  alignas(16) unsigned char rgba[BLOCK_SIZE * BLOCK_SIZE * 4];
+};
+
+// Copies the block at block coordinates (bx, by) out of an image with 1-4 channels. Missing
+// channels read as 0 (alpha as 255), pixels past the right/bottom edge repeat the last ones.
+inline void loadBlock(const unsigned char* pixels, const int width, const int height, const int channels,
+                      const int bx, const int by, BlockPixels& block)
+{
+  for (int y = 0; y < BLOCK_SIZE; y++)
+  {
+    const int py = std::min(by * BLOCK_SIZE + y, height - 1);
+    for (int x = 0; x < BLOCK_SIZE; x++)
+    {
+      const int px = std::min(bx * BLOCK_SIZE + x, width - 1);
+      const unsigned char* source = pixels + (static_cast<size_t>(py) * width + px) * channels;
+      unsigned char* target = block.rgba + (y * BLOCK_SIZE + x) * 4;
+      target[0] = source[0];
+      target[1] = channels > 1 ? source[1] : 0;
+      target[2] = channels > 2 ? source[2] : 0;
+      target[3] = channels > 3 ? source[3] : 255;
+    }
+  }
+}
+
+inline uint16_t packRGB565(const int r, const int g, const int b)
+{
+  return static_cast<uint16_t>(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | (b * 31 + 127) / 255);
+}
+
+inline void unpackRGB565(const uint16_t colour, int* rgb)
+{
+  const int r = colour >> 11, g = colour >> 5 & 63, b = colour & 31;
+  rgb[0] = r << 3 | r >> 2;
+  rgb[1] = g << 2 | g >> 4;
+  rgb[2] = b << 3 | b >> 2;
+}
+
+// Picks the endpoints of a BC1 block from the colour bounding box (van Waveren, "Real-Time DXT
+// Compression"): the box is inset by 1/16 of its size on every side, and the diagonal through it
+// follows the sign of the red/green and blue/green covariance. Endpoints come back ordered so
+// that c0 > c1, which selects the four colour mode; c0 == c1 means a single colour block.
+inline void _bc1Endpoints(const int* minColour, const int* maxColour, const float covarianceRG,
+                          const float covarianceBG, uint16_t* c0, uint16_t* c1)
+{
+  int low[3], high[3];
+  for (int c = 0; c < 3; c++)
+  {
+    const int inset = (maxColour[c] - minColour[c]) >> 4;
+    low[c] = minColour[c] + inset;
+    high[c] = maxColour[c] - inset;
+  }
+  if (covarianceRG < 0.0f)
+    std::swap(low[0], high[0]);
+  if (covarianceBG < 0.0f)
+    std::swap(low[2], high[2]);
+
+  *c0 = packRGB565(high[0], high[1], high[2]);
+  *c1 = packRGB565(low[0], low[1], low[2]);
+  if (*c0 < *c1)
+    std::swap(*c0, *c1);
+}
+
+// Writes a BC1 block. levels[i] is how far pixel i is along the line from c0 (0) to c1 (3).
+inline void _packBC1(const uint16_t c0, const uint16_t c1, const int* levels, unsigned char* out)
+{
+  static constexpr uint32_t CODES[4] = {0, 2, 3, 1};
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; i++)
+  {
+    indices |= CODES[levels[i]] << (2 * i);
+  }
+  std::memcpy(out, &c0, 2);
+  std::memcpy(out + 2, &c1, 2);
+  std::memcpy(out + 4, &indices, 4);
+}
+
+// Writes a BC4 block. levels[i] is how far pixel i is along the line from a0 (0) to a1 (7).
+inline void _packBC4(const int a0, const int a1, const int* levels, unsigned char* out)
+{
+  static constexpr uint64_t CODES[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+  uint64_t indices = 0;
+  for (int i = 0; i < 16; i++)
+  {
+    indices |= CODES[levels[i]] << (3 * i);
+  }
+  out[0] = static_cast<unsigned char>(a0);
+  out[1] = static_cast<unsigned char>(a1);
+  std::memcpy(out + 2, &indices, 6);
+}
+
+// Reference encoders, one pixel at a time
+inline void encodeBC1Scalar(const BlockPixels& block, unsigned char* out)
+{
+  int minColour[3] = {255, 255, 255}, maxColour[3] = {0, 0, 0};
+  float sumR = 0.0f, sumG = 0.0f, sumB = 0.0f, sumRG = 0.0f, sumBG = 0.0f;
+  for (int i = 0; i < 16; i++)
+  {
+    const unsigned char* p = block.rgba + i * 4;
+    for (int c = 0; c < 3; c++)
+    {
+      minColour[c] = std::min<int>(minColour[c], p[c]);
+      maxColour[c] = std::max<int>(maxColour[c], p[c]);
+    }
+    sumR += p[0];
+    sumG += p[1];
+    sumB += p[2];
+    sumRG += static_cast<float>(p[0]) * p[1];
+    sumBG += static_cast<float>(p[2]) * p[1];
+  }
+
+  uint16_t c0, c1;
+  _bc1Endpoints(minColour, maxColour, sumRG - sumR * sumG / 16.0f, sumBG - sumB * sumG / 16.0f, &c0, &c1);
+
+  int levels[16] = {};
+  if (c0 != c1)
+  {
+    int e0[3], e1[3];
+    unpackRGB565(c0, e0);
+    unpackRGB565(c1, e1);
+    const float axis[3] = {static_cast<float>(e1[0] - e0[0]), static_cast<float>(e1[1] - e0[1]),
+                           static_cast<float>(e1[2] - e0[2])};
+    const float scale = 3.0f / (axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    for (int i = 0; i < 16; i++)
+    {
+      const unsigned char* p = block.rgba + i * 4;
+      const float t = ((p[0] - e0[0]) * axis[0] + (p[1] - e0[1]) * axis[1] + (p[2] - e0[2]) * axis[2]) * scale;
+      levels[i] = static_cast<int>(std::nearbyint(std::clamp(t, 0.0f, 3.0f)));
+    }
+  }
+  _packBC1(c0, c1, levels, out);
+}
+
+inline void encodeBC4Scalar(const BlockPixels& block, const int channel, unsigned char* out)
+{
+  int low = 255, high = 0;
+  for (int i = 0; i < 16; i++)
+  {
+    low = std::min<int>(low, block.rgba[i * 4 + channel]);
+    high = std::max<int>(high, block.rgba[i * 4 + channel]);
+  }
+
+  int levels[16] = {};
+  if (low != high)
+  {
+    const float scale = 7.0f / static_cast<float>(high - low);
+    for (int i = 0; i < 16; i++)
+    {
+      const float t = static_cast<float>(high - block.rgba[i * 4 + channel]) * scale;
+      levels[i] = static_cast<int>(std::nearbyint(std::clamp(t, 0.0f, 7.0f)));
+    }
+  }
+  _packBC4(high, low, levels, out);
+}
+
+inline void encodeBlockScalar(const BlockFormat format, const BlockPixels& block, unsigned char* out)
+{
+  switch (format)
+  {
+    case BlockFormat::BC1: encodeBC1Scalar(block, out); break;
+    case BlockFormat::BC3: encodeBC4Scalar(block, 3, out); encodeBC1Scalar(block, out + 8); break;
+    case BlockFormat::BC4: encodeBC4Scalar(block, 0, out); break;
+    case BlockFormat::BC5: encodeBC4Scalar(block, 0, out); encodeBC4Scalar(block, 1, out + 8); break;
+  }
+}
+
+#if defined(__SSE2__)
+// Each block row of four RGBA pixels is one 16 byte vector. Channels are split out into four
+// float lanes per row, so a whole block is processed in four iterations with the same
+// arithmetic as the scalar encoders.
+inline float _horizontalSum(__m128 v)
+{
+  v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtss_f32(v);
+}
+
+inline __m128 _channel(const __m128i row, const int channel)
+{
+  return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(row, 8 * channel), _mm_set1_epi32(0xFF)));
+}
+
+// Per byte minimum/maximum over the four pixels of a vector, returned as a packed RGBA value
+inline uint32_t _pixelMin(__m128i v)
+{
+  v = _mm_min_epu8(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_min_epu8(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+inline uint32_t _pixelMax(__m128i v)
+{
+  v = _mm_max_epu8(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_max_epu8(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+inline void encodeBC1(const BlockPixels& block, unsigned char* out)
+{
+  __m128i rows[4];
+  __m128 r[4], g[4], b[4];
+  __m128 sumR = _mm_setzero_ps(), sumG = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+  __m128 sumRG = _mm_setzero_ps(), sumBG = _mm_setzero_ps();
+  for (int y = 0; y < 4; y++)
+  {
+    rows[y] = _mm_load_si128(reinterpret_cast<const __m128i*>(block.rgba) + y);
+    r[y] = _channel(rows[y], 0);
+    g[y] = _channel(rows[y], 1);
+    b[y] = _channel(rows[y], 2);
+    sumR = _mm_add_ps(sumR, r[y]);
+    sumG = _mm_add_ps(sumG, g[y]);
+    sumB = _mm_add_ps(sumB, b[y]);
+    sumRG = _mm_add_ps(sumRG, _mm_mul_ps(r[y], g[y]));
+    sumBG = _mm_add_ps(sumBG, _mm_mul_ps(b[y], g[y]));
+  }
+
+  const uint32_t low = _pixelMin(_mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3])));
+  const uint32_t high = _pixelMax(_mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3])));
+  const int minColour[3] = {static_cast<int>(low & 0xFF), static_cast<int>(low >> 8 & 0xFF), static_cast<int>(low >> 16 & 0xFF)};
+  const int maxColour[3] = {static_cast<int>(high & 0xFF), static_cast<int>(high >> 8 & 0xFF), static_cast<int>(high >> 16 & 0xFF)};
+
+  const float totalG = _horizontalSum(sumG);
+  uint16_t c0, c1;
+  _bc1Endpoints(minColour, maxColour, _horizontalSum(sumRG) - _horizontalSum(sumR) * totalG / 16.0f,
+                _horizontalSum(sumBG) - _horizontalSum(sumB) * totalG / 16.0f, &c0, &c1);
+
+  alignas(16) int levels[16] = {};
+  if (c0 != c1)
+  {
+    int e0[3], e1[3];
+    unpackRGB565(c0, e0);
+    unpackRGB565(c1, e1);
+    const float axis[3] = {static_cast<float>(e1[0] - e0[0]), static_cast<float>(e1[1] - e0[1]),
+                           static_cast<float>(e1[2] - e0[2])};
+    const __m128 scale = _mm_set1_ps(3.0f / (axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]));
+    const __m128 axisR = _mm_set1_ps(axis[0]), axisG = _mm_set1_ps(axis[1]), axisB = _mm_set1_ps(axis[2]);
+    const __m128 e0R = _mm_set1_ps(e0[0]), e0G = _mm_set1_ps(e0[1]), e0B = _mm_set1_ps(e0[2]);
+    for (int y = 0; y < 4; y++)
+    {
+      const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(r[y], e0R), axisR),
+                                               _mm_mul_ps(_mm_sub_ps(g[y], e0G), axisG)),
+                                    _mm_mul_ps(_mm_sub_ps(b[y], e0B), axisB));
+      const __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(dot, scale), _mm_setzero_ps()), _mm_set1_ps(3.0f));
+      _mm_store_si128(reinterpret_cast<__m128i*>(levels) + y, _mm_cvtps_epi32(t));
+    }
+  }
+  _packBC1(c0, c1, levels, out);
+}
+
+inline void encodeBC4(const BlockPixels& block, const int channel, unsigned char* out)
+{
+  __m128 values[4];
+  for (int y = 0; y < 4; y++)
+  {
+    values[y] = _channel(_mm_load_si128(reinterpret_cast<const __m128i*>(block.rgba) + y), channel);
+  }
+  __m128 low = _mm_min_ps(_mm_min_ps(values[0], values[1]), _mm_min_ps(values[2], values[3]));
+  __m128 high = _mm_max_ps(_mm_max_ps(values[0], values[1]), _mm_max_ps(values[2], values[3]));
+  low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(1, 0, 3, 2)));
+  low = _mm_min_ps(low, _mm_shuffle_ps(low, low, _MM_SHUFFLE(2, 3, 0, 1)));
+  high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(1, 0, 3, 2)));
+  high = _mm_max_ps(high, _mm_shuffle_ps(high, high, _MM_SHUFFLE(2, 3, 0, 1)));
+  const int a1 = _mm_cvtss_si32(low), a0 = _mm_cvtss_si32(high);
+
+  alignas(16) int levels[16] = {};
+  if (a0 != a1)
+  {
+    const __m128 scale = _mm_set1_ps(7.0f / static_cast<float>(a0 - a1));
+    const __m128 top = _mm_set1_ps(static_cast<float>(a0));
+    for (int y = 0; y < 4; y++)
+    {
+      const __m128 t = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(top, values[y]), scale), _mm_setzero_ps()),
+                                  _mm_set1_ps(7.0f));
+      _mm_store_si128(reinterpret_cast<__m128i*>(levels) + y, _mm_cvtps_epi32(t));
+    }
+  }
+  _packBC4(a0, a1, levels, out);
+}
+
+inline void encodeBlock(const BlockFormat format, const BlockPixels& block, unsigned char* out)
+{
+  switch (format)
+  {
+    case BlockFormat::BC1: encodeBC1(block, out); break;
+    case BlockFormat::BC3: encodeBC4(block, 3, out); encodeBC1(block, out + 8); break;
+    case BlockFormat::BC4: encodeBC4(block, 0, out); break;
+    case BlockFormat::BC5: encodeBC4(block, 0, out); encodeBC4(block, 1, out + 8); break;
+  }
+}
+#else
+inline void encodeBlock(const BlockFormat format, const BlockPixels& block, unsigned char* out)
+{
+  encodeBlockScalar(format, block, out);
+}
+#endif
+
+typedef void (*BlockEncoder)(BlockFormat format, const BlockPixels& block, unsigned char* out);
+
+struct CompressedImage
+{
+  BlockFormat format;
+  int width, height;
+  std::vector<unsigned char> blocks; // Block rows bottom to top, like the source image rows
+};
+
+inline int blockCount(const int pixels) { return (pixels + BLOCK_SIZE - 1) / BLOCK_SIZE; }
+
+// Encodes an image with 1-4 channels. Block rows are handed out to the threads one at a time,
+// blocks are independent so no other synchronisation is needed.
+inline CompressedImage compressImage(const unsigned char* pixels, const int width, const int height,
+                                     const int channels, const BlockFormat format,
+                                     const uint threadCount = std::max(1u, std::thread::hardware_concurrency()),
+                                     const BlockEncoder encoder = encodeBlock)
+{
+  const int blocksX = blockCount(width), blocksY = blockCount(height);
+  const size_t rowBytes = blocksX * blockBytes(format);
+  CompressedImage image{format, width, height, std::vector<unsigned char>(rowBytes * blocksY)};
+
+  std::atomic<int> nextRow{0};
+  const auto work = [&] {
+    BlockPixels block;
+    for (int by = nextRow++; by < blocksY; by = nextRow++)
+    {
+      unsigned char* out = image.blocks.data() + by * rowBytes;
+      for (int bx = 0; bx < blocksX; bx++, out += blockBytes(format))
+      {
+        loadBlock(pixels, width, height, channels, bx, by, block);
+        encoder(format, block, out);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (uint i = 1; i < std::min<uint>(threadCount, blocksY); i++)
+  {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  return image;
+}
+
+inline void _decodeBC1(const unsigned char* in, unsigned char* rgba)
+{
+  uint16_t c0, c1;
+  uint32_t indices;
+  std::memcpy(&c0, in, 2);
+  std::memcpy(&c1, in + 2, 2);
+  std::memcpy(&indices, in + 4, 4);
+
+  int palette[4][4];
+  unpackRGB565(c0, palette[0]);
+  unpackRGB565(c1, palette[1]);
+  for (int c = 0; c < 3; c++)
+  {
+    // Four colour mode only; three colour blocks with c0 <= c1 are never produced
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  for (int i = 0; i < 16; i++)
+  {
+    const int* colour = palette[indices >> (2 * i) & 3];
+    rgba[i * 4] = colour[0];
+    rgba[i * 4 + 1] = colour[1];
+    rgba[i * 4 + 2] = colour[2];
+  }
+}
+
+inline void _decodeBC4(const unsigned char* in, unsigned char* rgba, const int channel)
+{
+  const int a0 = in[0], a1 = in[1];
+  uint64_t indices = 0;
+  std::memcpy(&indices, in + 2, 6);
+
+  int palette[8] = {a0, a1};
+  if (a0 > a1)
+  {
+    for (int i = 1; i < 7; i++)
+      palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+  }
+  else
+  {
+    for (int i = 1; i < 5; i++)
+      palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  for (int i = 0; i < 16; i++)
+  {
+    rgba[i * 4 + channel] = palette[indices >> (3 * i) & 7];
+  }
+}
+
+// Decodes to RGBA8 with the same channel defaults as loadBlock. Used to measure the encoding
+// error and to upload compressed data on drivers without support for its format.
+inline std::vector<unsigned char> decompressImage(const CompressedImage& image)
+{
+  const int blocksX = blockCount(image.width), blocksY = blockCount(image.height);
+  std::vector<unsigned char> pixels(static_cast<size_t>(image.width) * image.height * 4);
+  const unsigned char* in = image.blocks.data();
+  for (int by = 0; by < blocksY; by++)
+  {
+    for (int bx = 0; bx < blocksX; bx++, in += blockBytes(image.format))
+    {
+      BlockPixels block{};
+      for (int i = 0; i < 16; i++)
+        block.rgba[i * 4 + 3] = 255;
+
+      switch (image.format)
+      {
+        case BlockFormat::BC1: _decodeBC1(in, block.rgba); break;
+        case BlockFormat::BC3: _decodeBC4(in, block.rgba, 3); _decodeBC1(in + 8, block.rgba); break;
+        case BlockFormat::BC4: _decodeBC4(in, block.rgba, 0); break;
+        case BlockFormat::BC5: _decodeBC4(in, block.rgba, 0); _decodeBC4(in + 8, block.rgba, 1); break;
+      }
+
+      for (int y = 0; y < BLOCK_SIZE && by * BLOCK_SIZE + y < image.height; y++)
+      {
+        const int width = std::min(BLOCK_SIZE, image.width - bx * BLOCK_SIZE);
+        std::memcpy(pixels.data() + ((static_cast<size_t>(by) * BLOCK_SIZE + y) * image.width + bx * BLOCK_SIZE) * 4,
+                    block.rgba + y * BLOCK_SIZE * 4, width * 4);
+      }
+    }
+  }
+  return pixels;
+}
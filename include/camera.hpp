@@ -27,6 +27,20 @@ struct CameraConfig {
     static constexpr float MAX_PITCH = 89.0f;
     static constexpr float MIN_ZOOM = 1.0f;
     static constexpr float MAX_ZOOM = 45.0f;
+    static constexpr float DEFAULT_ASPECT_RATIO = 4.0f / 3.0f;
+    static constexpr float DEFAULT_NEAR = 0.1f;
+    static constexpr float DEFAULT_FAR = 100.0f;
+};
+
+// Matrices derived from a camera. They only change when the camera moves or its projection
+// parameters do, so they are computed on first use after a change instead of on every call.
+struct CameraMatrices {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProj;
+    glm::mat4 inverseView;
+    glm::mat4 inverseProjection;
+    glm::mat4 inverseViewProj;
 };
 
 class Camera {
@@ -40,7 +54,36 @@ class Camera {
 
     float movementSpeed;
     float mouseSensitivity;
-    float zoom;
+    float zoom; // Vertical field of view in degrees
+
+    float aspectRatio = CameraConfig::DEFAULT_ASPECT_RATIO;
+    float nearPlane = CameraConfig::DEFAULT_NEAR;
+    float farPlane = CameraConfig::DEFAULT_FAR;
+
+    mutable CameraMatrices matrices{};
+    mutable bool viewDirty = true;
+    mutable bool projectionDirty = true;
+
+    // Brings the cached matrices up to date, viewProj and its inverse follow either half
+    const CameraMatrices& updateMatrices() const {
+        if (!viewDirty && !projectionDirty)
+            return matrices;
+
+        if (viewDirty) {
+            matrices.view = glm::lookAt(position, position + front, up);
+            // The view matrix is a rotation and a translation, its inverse is the camera's transform
+            matrices.inverseView = glm::mat4(glm::vec4(right, 0.0f), glm::vec4(up, 0.0f), glm::vec4(-front, 0.0f),
+                                             glm::vec4(position, 1.0f));
+        }
+        if (projectionDirty) {
+            matrices.projection = glm::perspective(glm::radians(zoom), aspectRatio, nearPlane, farPlane);
+            matrices.inverseProjection = glm::inverse(matrices.projection);
+        }
+        matrices.viewProj = matrices.projection * matrices.view;
+        matrices.inverseViewProj = matrices.inverseView * matrices.inverseProjection;
+        viewDirty = projectionDirty = false;
+        return matrices;
+    }
 
     void updateCameraVectors() {
         const glm::vec3 newFront{
@@ -52,6 +95,7 @@ class Camera {
         front = glm::normalize(newFront);
         right = glm::normalize(glm::cross(front, worldUp));
         up = glm::normalize(glm::cross(right, front));
+        viewDirty = true;
     }
 
 public:
@@ -69,8 +113,22 @@ public:
         updateCameraVectors();
     }
 
-    [[nodiscard]] glm::mat4 getViewMatrix() const {
-        return glm::lookAt(position, position + front, up);
+    [[nodiscard]] const glm::mat4& getViewMatrix() const { return updateMatrices().view; }
+    [[nodiscard]] const glm::mat4& getProjectionMatrix() const { return updateMatrices().projection; }
+    [[nodiscard]] const glm::mat4& getViewProjMatrix() const { return updateMatrices().viewProj; }
+    [[nodiscard]] const CameraMatrices& getMatrices() const { return updateMatrices(); }
+
+    void setAspectRatio(const float ratio) {
+        if (ratio != aspectRatio) {
+            aspectRatio = ratio;
+            projectionDirty = true;
+        }
+    }
+
+    void setClipPlanes(const float near, const float far) {
+        nearPlane = near;
+        farPlane = far;
+        projectionDirty = true;
     }
 
     void processKeyboard(CameraMovement direction, float deltaTime) {
@@ -90,6 +148,7 @@ public:
                 position += right * velocity;
                 break;
         }
+        viewDirty = true;
     }
 
     void processMouseMovement(float xOffset, float yOffset, bool constrainPitch = true) {
@@ -110,9 +169,18 @@ public:
         zoom = std::clamp(zoom - yOffset, 
                          CameraConfig::MIN_ZOOM,
                          CameraConfig::MAX_ZOOM);
+        projectionDirty = true;
     }
 
     [[nodiscard]] float getZoom() const { return zoom; }
+    [[nodiscard]] float getAspectRatio() const { return aspectRatio; }
     [[nodiscard]] const glm::vec3& getPosition() const { return position; }
     [[nodiscard]] const glm::vec3& getFront() const { return front; }
+    [[nodiscard]] const glm::vec3& getRight() const { return right; }
+    [[nodiscard]] float getMovementSpeed() const { return movementSpeed; }
+
+    void setPosition(const glm::vec3& newPosition) {
+        position = newPosition;
+        viewDirty = true;
+    }
 };
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+#include <algorithm>
+#include <cstring>
+
+// True if one of the arguments from argv[first] on is exactly flag
+inline bool hasFlag(const int argc, char** argv, const char* flag, const int first = 1)
+{
+  return std::any_of(argv + std::min(first, argc), argv + argc,
+                     [&](const char* arg) { return std::strcmp(arg, flag) == 0; });
+}
@@ -0,0 +1,171 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+
+// Hands the latest value from one producer thread to one consumer thread without locks or
+// waiting. The producer fills its own slot and swaps it with the shared one, the consumer swaps
+// its slot with the shared one when that holds something new. Values the consumer didn't get
+// to in time are overwritten, which is what a renderer wants from a simulation.
+template <typename T>
+class TripleBuffer
+{
+  static constexpr uint8_t INDEX_MASK = 3;
+  static constexpr uint8_t FRESH = 4; // Set on the shared index until the consumer takes it
+
+  // Each slot on its own cache line, the two threads write different ones
+  struct alignas(64) Slot
+  {
+    T value;
+  };
+
+  std::array<Slot, 3> _slots;
+  uint8_t _writeIndex = 0; // Producer only
+  alignas(64) std::atomic<uint8_t> _shared{1};
+  uint8_t _readIndex = 2; // Consumer only
+
+public:
+  explicit TripleBuffer(const T& initial = T{}) : _slots{Slot{initial}, Slot{initial}, Slot{initial}} {}
+
+  // Producer: fill back(), then publish() it
+  T& back() { return _slots[_writeIndex].value; }
+
+  void publish()
+  {
+    _writeIndex = _shared.exchange(_writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+  }
+
+  void write(const T& value)
+  {
+    back() = value;
+    publish();
+  }
+
+  // Consumer: makes front() the latest published value. Returns false if nothing new was published.
+  bool update()
+  {
+    if ((_shared.load(std::memory_order_relaxed) & FRESH) == 0)
+      return false;
+    _readIndex = _shared.exchange(_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+  [[nodiscard]] const T& front() const { return _slots[_readIndex].value; }
+};
+
+// The two latest states of a simulation and the time the newer one was reached
+template <typename State>
+struct SimulationSnapshot
+{
+  State previous;
+  State current;
+  double time = 0.0; // Seconds since the simulation started
+  uint64_t tick = 0;
+};
+
+// The two latest steps and how far between them a frame is drawn, see FixedStepSimulation::sampleSteps()
+template <typename State>
+struct SimulationSample
+{
+  const State& from;
+  const State& to;
+  double alpha;
+};
+
+// Steps State at a fixed rate on its own thread, independent of how long frames take. The render
+// thread passes Input in with setInput() and calls sample() every frame for a state to draw,
+// interpolated between the two latest steps. Rendering one step behind the simulation this way
+// always has a newer state to move towards, so motion is smooth at any frame rate, at the cost of
+// one step of latency for whatever the simulation drives. States with a lot of data in them can
+// skip the interpolation function and use sampleSteps() to interpolate only what a frame draws.
+template <typename State, typename Input>
+class FixedStepSimulation
+{
+public:
+  using StepFunction = std::function<void(State& state, const Input& input, double step)>;
+  using InterpolateFunction = std::function<State(const State& from, const State& to, double alpha)>;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  // Behind by more steps than this, the simulation drops them instead of running a burst to catch up
+  static constexpr int MAX_CATCH_UP_STEPS = 5;
+
+  const double _step;
+  const StepFunction _stepFunction;
+  const InterpolateFunction _interpolate;
+  TripleBuffer<Input> _input;
+  TripleBuffer<SimulationSnapshot<State>> _snapshots;
+  const Clock::time_point _start = Clock::now();
+  std::atomic<bool> _running{true};
+  std::thread _thread;
+
+  void _run(const State& initial)
+  {
+    SimulationSnapshot<State> snapshot{initial, initial};
+    const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(_step));
+    Clock::time_point next = _start;
+    while (_running.load(std::memory_order_relaxed))
+    {
+      next += step;
+      std::this_thread::sleep_until(next);
+      if (Clock::now() - next > MAX_CATCH_UP_STEPS * step)
+        next = Clock::now();
+
+      _input.update();
+      snapshot.previous = snapshot.current;
+      _stepFunction(snapshot.current, _input.front(), _step);
+      snapshot.time = std::chrono::duration<double>(next - _start).count();
+      snapshot.tick++;
+      _snapshots.write(snapshot);
+    }
+  }
+
+public:
+  // Starts stepping right away, stepsPerSecond times a second. interpolate is only needed for sample().
+  FixedStepSimulation(const State& initial, const double stepsPerSecond, StepFunction step,
+                      InterpolateFunction interpolate = nullptr, const Input& input = Input{})
+    : _step(1.0 / stepsPerSecond), _stepFunction(std::move(step)), _interpolate(std::move(interpolate)),
+      _input(input), _snapshots(SimulationSnapshot<State>{initial, initial}),
+      _thread(&FixedStepSimulation::_run, this, initial)
+  {
+  }
+
+  ~FixedStepSimulation()
+  {
+    _running.store(false, std::memory_order_relaxed);
+    _thread.join();
+  }
+
+  FixedStepSimulation(const FixedStepSimulation&) = delete;
+  FixedStepSimulation& operator=(const FixedStepSimulation&) = delete;
+
+  // Input for the following steps, from the render thread only
+  void setInput(const Input& input) { _input.write(input); }
+
+  // The two steps to draw now between, from the render thread only. They are not copied: the
+  // references stay valid, also for other threads, until the render thread samples again.
+  SimulationSample<State> sampleSteps()
+  {
+    _snapshots.update();
+    const SimulationSnapshot<State>& snapshot = _snapshots.front();
+    const double now = std::chrono::duration<double>(Clock::now() - _start).count();
+    return {snapshot.previous, snapshot.current, std::clamp((now - snapshot.time) / _step, 0.0, 1.0)};
+  }
+
+  // The state to draw now, from the render thread only
+  State sample()
+  {
+    const SimulationSample<State> steps = sampleSteps();
+    return _interpolate(steps.from, steps.to, steps.alpha);
+  }
+
+  // Steps taken as of the latest sample()
+  [[nodiscard]] uint64_t ticks() const { return _snapshots.front().tick; }
+  [[nodiscard]] double stepSeconds() const { return _step; }
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+
+#include "camera.hpp"
+#include "gl_state.hpp"
+#include "shader.hpp"
+
+#include "ext/glad/glad.h"
+#include "ext/glm/glm.hpp"
+
+// Per-frame values shared by every program through the `FrameData` uniform block.
+// The member order and padding follow the std140 layout, so the struct can be copied
+// into the buffer as is. The matching GLSL declaration is:
+//
+//   layout (std140) uniform FrameData {
+//       mat4 view;
+//       mat4 projection;
+//       mat4 viewProj;
+//       vec4 cameraPosition;
+//       float time;
+//   };
+struct FrameData
+{
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProj;
+  glm::vec4 cameraPosition; // w is unused, a vec3 would be padded to 16 bytes anyway
+  float time;
+  float _padding[3];
+};
+
+static_assert(sizeof(FrameData) == 3 * sizeof(glm::mat4) + 2 * sizeof(glm::vec4),
+              "FrameData must match the std140 layout of the FrameData uniform block");
+
+// Uniform buffer holding FrameData, bound to FRAME_DATA_BINDING. Updating it once per
+// frame replaces the view/projection uploads to each individual program.
+class FrameUniformBuffer
+{
+  unsigned int UBO;
+  FrameData _data{};
+
+  void _setCamera(const Camera& camera)
+  {
+    const CameraMatrices& matrices = camera.getMatrices();
+    _data.view = matrices.view;
+    _data.projection = matrices.projection;
+    _data.viewProj = matrices.viewProj;
+    _data.cameraPosition = glm::vec4(camera.getPosition(), 1.0f);
+  }
+
+public:
+  FrameUniformBuffer()
+  {
+    glGenBuffers(1, &UBO);
+    glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+    glState().bindBufferBase(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, UBO);
+  }
+
+  // The matrices come from the camera's cache, nothing is recomputed unless the camera changed
+  void update(const Camera& camera, const float time)
+  {
+    _setCamera(camera);
+    _data.time = time;
+
+    glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &_data);
+  }
+
+  // Re-uploads only the camera part of the block, for input latched after update(). Draws
+  // issued before the call keep seeing the old values.
+  void updateCamera(const Camera& camera)
+  {
+    _setCamera(camera);
+
+    glState().bindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, offsetof(FrameData, time), &_data);
+  }
+
+  [[nodiscard]] const FrameData& data() const { return _data; }
+};
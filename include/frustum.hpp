@@ -0,0 +1,570 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FRUSTUM_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include "worker_pool.hpp"
+
+#include "ext/glm/glm.hpp"
+
+typedef unsigned int uint;
+
+// The six planes of a view frustum as (normal, distance) with normals pointing inwards,
+// so a point p is inside a plane when dot(normal, p) + distance >= 0.
+struct Frustum
+{
+  std::array<glm::vec4, 6> planes;
+
+  // Extracts the planes from a combined view-projection matrix (Gribb & Hartmann). The planes
+  // are in world space when given projection * view.
+  static Frustum fromMatrix(const glm::mat4& viewProj)
+  {
+    // glm matrices are column major, so viewProj[c][r] is row r of column c
+    const auto row = [&](const int r) { return glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]); };
+
+    Frustum frustum{};
+    frustum.planes = {
+      row(3) + row(0), // Left
+      row(3) - row(0), // Right
+      row(3) + row(1), // Bottom
+      row(3) - row(1), // Top
+      row(3) + row(2), // Near
+      row(3) - row(2), // Far
+    };
+    for (glm::vec4& plane : frustum.planes)
+    {
+      plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+  }
+
+  [[nodiscard]] bool intersectsSphere(const glm::vec3& centre, const float radius) const
+  {
+    for (const glm::vec4& plane : planes)
+    {
+      if (glm::dot(glm::vec3(plane), centre) + plane.w < -radius)
+        return false;
+    }
+    return true;
+  }
+
+  [[nodiscard]] bool intersectsBox(const glm::vec3& centre, const glm::vec3& extents) const
+  {
+    for (const glm::vec4& plane : planes)
+    {
+      // Projected "radius" of the box onto the plane normal
+      const float radius = glm::dot(glm::abs(glm::vec3(plane)), extents);
+      if (glm::dot(glm::vec3(plane), centre) + plane.w < -radius)
+        return false;
+    }
+    return true;
+  }
+};
+
+// Bounding spheres in structure of arrays form, so the culling loops can load 4 or 8 objects
+// per component with a single vector load.
+struct BoundingSpheres
+{
+  std::vector<float> x, y, z, radius;
+
+  void add(const glm::vec3& centre, const float r)
+  {
+    x.push_back(centre.x);
+    y.push_back(centre.y);
+    z.push_back(centre.z);
+    radius.push_back(r);
+  }
+
+  [[nodiscard]] size_t size() const { return x.size(); }
+};
+
+// Axis aligned boxes as centre and half extents, in structure of arrays form
+struct BoundingBoxes
+{
+  std::vector<float> x, y, z;
+  std::vector<float> extentX, extentY, extentZ;
+
+  void add(const glm::vec3& centre, const glm::vec3& extents)
+  {
+    x.push_back(centre.x);
+    y.push_back(centre.y);
+    z.push_back(centre.z);
+    extentX.push_back(extents.x);
+    extentY.push_back(extents.y);
+    extentZ.push_back(extents.z);
+  }
+
+  [[nodiscard]] size_t size() const { return x.size(); }
+};
+
+// Every culling routine writes the indices of the objects that intersect the frustum to the
+// front of `visible`, in ascending order, and returns how many there are. `visible` is grown to
+// the object count plus some slack for whole-vector stores, but never shrunk, so reusing it
+// across frames needs neither a reallocation nor clearing.
+constexpr size_t CULLING_OUTPUT_SLACK = 16;
+
+// Instruction sets the culling loops come in. The best one the CPU supports is picked at runtime,
+// so a default build gets AVX2 or AVX-512 without -march=native.
+enum class CullingPath
+{
+  Scalar,
+  SSE2,   // 4 objects per iteration, baseline x86-64
+  AVX2,   // 8 objects per iteration, with FMA
+  AVX512, // 16 objects per iteration
+};
+
+inline const char* cullingPathName(const CullingPath path)
+{
+  switch (path)
+  {
+    case CullingPath::SSE2: return "SSE2";
+    case CullingPath::AVX2: return "AVX2";
+    case CullingPath::AVX512: return "AVX-512";
+    default: return "scalar";
+  }
+}
+
+inline bool cullingPathSupported(const CullingPath path)
+{
+#ifdef FRUSTUM_X86_DISPATCH
+  switch (path)
+  {
+    case CullingPath::AVX512: return __builtin_cpu_supports("avx512f");
+    case CullingPath::AVX2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    default: return true;
+  }
+#else
+  return path == CullingPath::Scalar;
+#endif
+}
+
+inline CullingPath cullingPath()
+{
+  static const CullingPath path = [] {
+    for (const CullingPath candidate : {CullingPath::AVX512, CullingPath::AVX2, CullingPath::SSE2})
+    {
+      if (cullingPathSupported(candidate))
+        return candidate;
+    }
+    return CullingPath::Scalar;
+  }();
+  return path;
+}
+
+// Reference loops, one object at a time. The range versions cull objects [begin, end) and write
+// their indices to out.
+inline size_t _cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, const size_t end,
+                                 uint* out)
+{
+  size_t count = 0;
+  for (; begin < end; begin++)
+  {
+    if (frustum.intersectsSphere({spheres.x[begin], spheres.y[begin], spheres.z[begin]}, spheres.radius[begin]))
+      out[count++] = begin;
+  }
+  return count;
+}
+
+inline size_t _cullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, size_t begin, const size_t end,
+                               uint* out)
+{
+  size_t count = 0;
+  for (; begin < end; begin++)
+  {
+    if (frustum.intersectsBox({boxes.x[begin], boxes.y[begin], boxes.z[begin]},
+                              {boxes.extentX[begin], boxes.extentY[begin], boxes.extentZ[begin]}))
+      out[count++] = begin;
+  }
+  return count;
+}
+
+inline size_t cullSpheresScalar(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint>& visible)
+{
+  if (visible.size() < spheres.size() + CULLING_OUTPUT_SLACK)
+    visible.resize(spheres.size() + CULLING_OUTPUT_SLACK);
+  return _cullSpheresScalar(frustum, spheres, 0, spheres.size(), visible.data());
+}
+
+inline size_t cullBoxesScalar(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint>& visible)
+{
+  if (visible.size() < boxes.size() + CULLING_OUTPUT_SLACK)
+    visible.resize(boxes.size() + CULLING_OUTPUT_SLACK);
+  return _cullBoxesScalar(frustum, boxes, 0, boxes.size(), visible.data());
+}
+
+#ifdef FRUSTUM_X86_DISPATCH
+// The SIMD loops test a group of objects against every plane, combine the results into a lane
+// mask and append the indices of the set lanes. Objects left over at the end of the range go
+// through the scalar loop.
+
+// Appends base + lane for every set bit of the lane mask
+inline size_t _appendVisibleLanes(uint* visible, size_t count, int mask, const size_t base)
+{
+  while (mask != 0)
+  {
+    visible[count++] = base + __builtin_ctz(mask);
+    mask &= mask - 1;
+  }
+  return count;
+}
+
+inline size_t _cullSpheresSSE2(const Frustum& frustum, const BoundingSpheres& spheres, size_t begin, const size_t end,
+                               uint* out)
+{
+  __m128 nx[6], ny[6], nz[6], d[6];
+  for (int p = 0; p < 6; p++)
+  {
+    nx[p] = _mm_set1_ps(frustum.planes[p].x);
+    ny[p] = _mm_set1_ps(frustum.planes[p].y);
+    nz[p] = _mm_set1_ps(frustum.planes[p].z);
+    d[p] = _mm_set1_ps(frustum.planes[p].w);
+  }
+
+  size_t count = 0;
+  for (; begin + 4 <= end; begin += 4)
+  {
+    const __m128 x = _mm_loadu_ps(&spheres.x[begin]);
+    const __m128 y = _mm_loadu_ps(&spheres.y[begin]);
+    const __m128 z = _mm_loadu_ps(&spheres.z[begin]);
+    const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[begin]));
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++)
+    {
+      const __m128 distance =
+        _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)), d[p]);
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+    }
+    count = _appendVisibleLanes(out, count, _mm_movemask_ps(inside), begin);
+  }
+  return count + _cullSpheresScalar(frustum, spheres, begin, end, out + count);
+}
+
+inline size_t _cullBoxesSSE2(const Frustum& frustum, const BoundingBoxes& boxes, size_t begin, const size_t end,
+                             uint* out)
+{
+  __m128 nx[6], ny[6], nz[6], absX[6], absY[6], absZ[6], d[6];
+  for (int p = 0; p < 6; p++)
+  {
+    const glm::vec4& plane = frustum.planes[p];
+    nx[p] = _mm_set1_ps(plane.x);
+    ny[p] = _mm_set1_ps(plane.y);
+    nz[p] = _mm_set1_ps(plane.z);
+    absX[p] = _mm_set1_ps(glm::abs(plane.x));
+    absY[p] = _mm_set1_ps(glm::abs(plane.y));
+    absZ[p] = _mm_set1_ps(glm::abs(plane.z));
+    d[p] = _mm_set1_ps(plane.w);
+  }
+
+  size_t count = 0;
+  for (; begin + 4 <= end; begin += 4)
+  {
+    const __m128 x = _mm_loadu_ps(&boxes.x[begin]);
+    const __m128 y = _mm_loadu_ps(&boxes.y[begin]);
+    const __m128 z = _mm_loadu_ps(&boxes.z[begin]);
+    const __m128 ex = _mm_loadu_ps(&boxes.extentX[begin]);
+    const __m128 ey = _mm_loadu_ps(&boxes.extentY[begin]);
+    const __m128 ez = _mm_loadu_ps(&boxes.extentZ[begin]);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++)
+    {
+      const __m128 distance =
+        _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], x), _mm_mul_ps(ny[p], y)), _mm_mul_ps(nz[p], z)), d[p]);
+      const __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_sub_ps(_mm_setzero_ps(), radius)));
+    }
+    count = _appendVisibleLanes(out, count, _mm_movemask_ps(inside), begin);
+  }
+  return count + _cullBoxesScalar(frustum, boxes, begin, end, out + count);
+}
+
+// Lanes of every 8-bit mask, packed to the front. Storing all 8 entries shuffled by this and
+// advancing by the popcount appends the visible indices without a branch per object, which
+// would mispredict whenever the visible objects are scattered.
+struct _CullingLaneTable
+{
+  alignas(32) uint32_t lanes[256][8];
+
+  _CullingLaneTable() : lanes{}
+  {
+    for (int mask = 0; mask < 256; mask++)
+    {
+      int count = 0;
+      for (int lane = 0; lane < 8; lane++)
+      {
+        if (mask >> lane & 1)
+          lanes[mask][count++] = lane;
+      }
+    }
+  }
+};
+
+inline const _CullingLaneTable& _cullingLaneTable()
+{
+  static const _CullingLaneTable table;
+  return table;
+}
+
+// A sphere is inside a plane when n.c + d + r >= 0, which is one add and three FMAs per plane.
+// The sign bits of all six are OR-ed together, so a lane stays visible if none is negative.
+__attribute__((target("avx2,fma"))) inline size_t _cullSpheresAVX2(const Frustum& frustum, const BoundingSpheres& spheres,
+                                                                    size_t begin, const size_t end, uint* out)
+{
+  __m256 nx[6], ny[6], nz[6], d[6];
+  for (int p = 0; p < 6; p++)
+  {
+    nx[p] = _mm256_set1_ps(frustum.planes[p].x);
+    ny[p] = _mm256_set1_ps(frustum.planes[p].y);
+    nz[p] = _mm256_set1_ps(frustum.planes[p].z);
+    d[p] = _mm256_set1_ps(frustum.planes[p].w);
+  }
+  const _CullingLaneTable& table = _cullingLaneTable();
+
+  size_t count = 0;
+  for (; begin + 8 <= end; begin += 8)
+  {
+    const __m256 x = _mm256_loadu_ps(&spheres.x[begin]);
+    const __m256 y = _mm256_loadu_ps(&spheres.y[begin]);
+    const __m256 z = _mm256_loadu_ps(&spheres.z[begin]);
+    const __m256 radius = _mm256_loadu_ps(&spheres.radius[begin]);
+
+    __m256 outside = _mm256_setzero_ps();
+    for (int p = 0; p < 6; p++)
+    {
+      const __m256 distance =
+        _mm256_fmadd_ps(nx[p], x, _mm256_fmadd_ps(ny[p], y, _mm256_fmadd_ps(nz[p], z, _mm256_add_ps(d[p], radius))));
+      outside = _mm256_or_ps(outside, distance);
+    }
+
+    const int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+    const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.lanes[mask]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_add_epi32(lanes, _mm256_set1_epi32(begin)));
+    count += __builtin_popcount(mask);
+  }
+  return count + _cullSpheresScalar(frustum, spheres, begin, end, out + count);
+}
+
+__attribute__((target("avx2,fma"))) inline size_t _cullBoxesAVX2(const Frustum& frustum, const BoundingBoxes& boxes,
+                                                                  size_t begin, const size_t end, uint* out)
+{
+  __m256 nx[6], ny[6], nz[6], absX[6], absY[6], absZ[6], d[6];
+  for (int p = 0; p < 6; p++)
+  {
+    const glm::vec4& plane = frustum.planes[p];
+    nx[p] = _mm256_set1_ps(plane.x);
+    ny[p] = _mm256_set1_ps(plane.y);
+    nz[p] = _mm256_set1_ps(plane.z);
+    absX[p] = _mm256_set1_ps(glm::abs(plane.x));
+    absY[p] = _mm256_set1_ps(glm::abs(plane.y));
+    absZ[p] = _mm256_set1_ps(glm::abs(plane.z));
+    d[p] = _mm256_set1_ps(plane.w);
+  }
+  const _CullingLaneTable& table = _cullingLaneTable();
+
+  size_t count = 0;
+  for (; begin + 8 <= end; begin += 8)
+  {
+    const __m256 x = _mm256_loadu_ps(&boxes.x[begin]);
+    const __m256 y = _mm256_loadu_ps(&boxes.y[begin]);
+    const __m256 z = _mm256_loadu_ps(&boxes.z[begin]);
+    const __m256 ex = _mm256_loadu_ps(&boxes.extentX[begin]);
+    const __m256 ey = _mm256_loadu_ps(&boxes.extentY[begin]);
+    const __m256 ez = _mm256_loadu_ps(&boxes.extentZ[begin]);
+
+    // n.c + d + |n|.e >= 0
+    __m256 outside = _mm256_setzero_ps();
+    for (int p = 0; p < 6; p++)
+    {
+      const __m256 radius = _mm256_fmadd_ps(absX[p], ex, _mm256_fmadd_ps(absY[p], ey, _mm256_fmadd_ps(absZ[p], ez, d[p])));
+      const __m256 distance = _mm256_fmadd_ps(nx[p], x, _mm256_fmadd_ps(ny[p], y, _mm256_fmadd_ps(nz[p], z, radius)));
+      outside = _mm256_or_ps(outside, distance);
+    }
+
+    const int mask = ~_mm256_movemask_ps(outside) & 0xFF;
+    const __m256i lanes = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.lanes[mask]));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + count), _mm256_add_epi32(lanes, _mm256_set1_epi32(begin)));
+    count += __builtin_popcount(mask);
+  }
+  return count + _cullBoxesScalar(frustum, boxes, begin, end, out + count);
+}
+
+// AVX-512 compares straight into a mask register and has a compressing store for the indices
+__attribute__((target("avx512f"))) inline size_t _cullSpheresAVX512(const Frustum& frustum,
+                                                                     const BoundingSpheres& spheres, size_t begin,
+                                                                     const size_t end, uint* out)
+{
+  __m512 nx[6], ny[6], nz[6], d[6];
+  for (int p = 0; p < 6; p++)
+  {
+    nx[p] = _mm512_set1_ps(frustum.planes[p].x);
+    ny[p] = _mm512_set1_ps(frustum.planes[p].y);
+    nz[p] = _mm512_set1_ps(frustum.planes[p].z);
+    d[p] = _mm512_set1_ps(frustum.planes[p].w);
+  }
+  const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+  size_t count = 0;
+  for (; begin + 16 <= end; begin += 16)
+  {
+    const __m512 x = _mm512_loadu_ps(&spheres.x[begin]);
+    const __m512 y = _mm512_loadu_ps(&spheres.y[begin]);
+    const __m512 z = _mm512_loadu_ps(&spheres.z[begin]);
+    const __m512 radius = _mm512_loadu_ps(&spheres.radius[begin]);
+
+    __mmask16 inside = 0xFFFF;
+    for (int p = 0; p < 6; p++)
+    {
+      const __m512 distance =
+        _mm512_fmadd_ps(nx[p], x, _mm512_fmadd_ps(ny[p], y, _mm512_fmadd_ps(nz[p], z, _mm512_add_ps(d[p], radius))));
+      inside = _mm512_mask_cmp_ps_mask(inside, distance, _mm512_setzero_ps(), _CMP_GE_OQ);
+    }
+
+    _mm512_mask_compressstoreu_epi32(out + count, inside, _mm512_add_epi32(lanes, _mm512_set1_epi32(begin)));
+    count += __builtin_popcount(inside);
+  }
+  return count + _cullSpheresScalar(frustum, spheres, begin, end, out + count);
+}
+
+__attribute__((target("avx512f"))) inline size_t _cullBoxesAVX512(const Frustum& frustum, const BoundingBoxes& boxes,
+                                                                   size_t begin, const size_t end, uint* out)
+{
+  __m512 nx[6], ny[6], nz[6], absX[6], absY[6], absZ[6], d[6];
+  for (int p = 0; p < 6; p++)
+  {
+    const glm::vec4& plane = frustum.planes[p];
+    nx[p] = _mm512_set1_ps(plane.x);
+    ny[p] = _mm512_set1_ps(plane.y);
+    nz[p] = _mm512_set1_ps(plane.z);
+    absX[p] = _mm512_set1_ps(glm::abs(plane.x));
+    absY[p] = _mm512_set1_ps(glm::abs(plane.y));
+    absZ[p] = _mm512_set1_ps(glm::abs(plane.z));
+    d[p] = _mm512_set1_ps(plane.w);
+  }
+  const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+  size_t count = 0;
+  for (; begin + 16 <= end; begin += 16)
+  {
+    const __m512 x = _mm512_loadu_ps(&boxes.x[begin]);
+    const __m512 y = _mm512_loadu_ps(&boxes.y[begin]);
+    const __m512 z = _mm512_loadu_ps(&boxes.z[begin]);
+    const __m512 ex = _mm512_loadu_ps(&boxes.extentX[begin]);
+    const __m512 ey = _mm512_loadu_ps(&boxes.extentY[begin]);
+    const __m512 ez = _mm512_loadu_ps(&boxes.extentZ[begin]);
+
+    __mmask16 inside = 0xFFFF;
+    for (int p = 0; p < 6; p++)
+    {
+      const __m512 radius = _mm512_fmadd_ps(absX[p], ex, _mm512_fmadd_ps(absY[p], ey, _mm512_fmadd_ps(absZ[p], ez, d[p])));
+      const __m512 distance = _mm512_fmadd_ps(nx[p], x, _mm512_fmadd_ps(ny[p], y, _mm512_fmadd_ps(nz[p], z, radius)));
+      inside = _mm512_mask_cmp_ps_mask(inside, distance, _mm512_setzero_ps(), _CMP_GE_OQ);
+    }
+
+    _mm512_mask_compressstoreu_epi32(out + count, inside, _mm512_add_epi32(lanes, _mm512_set1_epi32(begin)));
+    count += __builtin_popcount(inside);
+  }
+  return count + _cullBoxesScalar(frustum, boxes, begin, end, out + count);
+}
+#endif
+
+inline size_t _cullSpheresRange(const CullingPath path, const Frustum& frustum, const BoundingSpheres& spheres,
+                                const size_t begin, const size_t end, uint* out)
+{
+  switch (path)
+  {
+#ifdef FRUSTUM_X86_DISPATCH
+    case CullingPath::AVX512: return _cullSpheresAVX512(frustum, spheres, begin, end, out);
+    case CullingPath::AVX2: return _cullSpheresAVX2(frustum, spheres, begin, end, out);
+    case CullingPath::SSE2: return _cullSpheresSSE2(frustum, spheres, begin, end, out);
+#endif
+    default: return _cullSpheresScalar(frustum, spheres, begin, end, out);
+  }
+}
+
+inline size_t _cullBoxesRange(const CullingPath path, const Frustum& frustum, const BoundingBoxes& boxes,
+                              const size_t begin, const size_t end, uint* out)
+{
+  switch (path)
+  {
+#ifdef FRUSTUM_X86_DISPATCH
+    case CullingPath::AVX512: return _cullBoxesAVX512(frustum, boxes, begin, end, out);
+    case CullingPath::AVX2: return _cullBoxesAVX2(frustum, boxes, begin, end, out);
+    case CullingPath::SSE2: return _cullBoxesSSE2(frustum, boxes, begin, end, out);
+#endif
+    default: return _cullBoxesScalar(frustum, boxes, begin, end, out);
+  }
+}
+
+// Objects per task when culling on a WorkerPool. Large enough that a task streams through a few
+// hundred KB, small enough that the threads finish close together.
+constexpr size_t CULLING_TASK_SIZE = 32768;
+
+// Culls [0, size) in tasks on the pool. Task t writes its indices to its own stretch of visible,
+// starting at its first object plus t slacks, and the stretches are moved together in order
+// afterwards. Only the few visible indices move, and the tasks never write to the same memory.
+template <typename CullRange>
+size_t _cullParallel(const size_t size, std::vector<uint>& visible, WorkerPool& pool, CullRange cullRange)
+{
+  const size_t taskCount = (size + CULLING_TASK_SIZE - 1) / CULLING_TASK_SIZE;
+  if (visible.size() < size + taskCount * CULLING_OUTPUT_SLACK + CULLING_OUTPUT_SLACK)
+    visible.resize(size + taskCount * CULLING_OUTPUT_SLACK + CULLING_OUTPUT_SLACK);
+
+  std::vector<size_t> counts(taskCount);
+  pool.run(taskCount, [&](const size_t task, uint) {
+    const size_t begin = task * CULLING_TASK_SIZE;
+    counts[task] = cullRange(begin, std::min(size, begin + CULLING_TASK_SIZE),
+                             visible.data() + begin + task * CULLING_OUTPUT_SLACK);
+  });
+
+  size_t count = 0;
+  for (size_t task = 0; task < taskCount; task++)
+  {
+    std::memmove(visible.data() + count, visible.data() + task * (CULLING_TASK_SIZE + CULLING_OUTPUT_SLACK),
+                 counts[task] * sizeof(uint));
+    count += counts[task];
+  }
+  return count;
+}
+
+inline size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint>& visible,
+                          const CullingPath path = cullingPath())
+{
+  if (visible.size() < spheres.size() + CULLING_OUTPUT_SLACK)
+    visible.resize(spheres.size() + CULLING_OUTPUT_SLACK);
+  return _cullSpheresRange(path, frustum, spheres, 0, spheres.size(), visible.data());
+}
+
+inline size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint>& visible,
+                        const CullingPath path = cullingPath())
+{
+  if (visible.size() < boxes.size() + CULLING_OUTPUT_SLACK)
+    visible.resize(boxes.size() + CULLING_OUTPUT_SLACK);
+  return _cullBoxesRange(path, frustum, boxes, 0, boxes.size(), visible.data());
+}
+
+// Same, spread over the threads of a pool. A single thread is limited by memory bandwidth long
+// before it runs out of arithmetic (1M spheres are 16 MB of bounds), so large object counts only
+// get much faster with more cores pulling data in.
+inline size_t cullSpheres(const Frustum& frustum, const BoundingSpheres& spheres, std::vector<uint>& visible,
+                          WorkerPool& pool, const CullingPath path = cullingPath())
+{
+  return _cullParallel(spheres.size(), visible, pool, [&](const size_t begin, const size_t end, uint* out) {
+    return _cullSpheresRange(path, frustum, spheres, begin, end, out);
+  });
+}
+
+inline size_t cullBoxes(const Frustum& frustum, const BoundingBoxes& boxes, std::vector<uint>& visible,
+                        WorkerPool& pool, const CullingPath path = cullingPath())
+{
+  return _cullParallel(boxes.size(), visible, pool, [&](const size_t begin, const size_t end, uint* out) {
+    return _cullBoxesRange(path, frustum, boxes, begin, end, out);
+  });
+}
@@ -0,0 +1,300 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "gl_state.hpp"
+#include "opengl_object.hpp"
+#include "vertex_layout.hpp"
+
+// First-fit free-list allocator over a range of `capacity` units. Free blocks are kept
+// sorted by offset so that neighbours can be merged back together when freed.
+class RangeAllocator
+{
+  // Offset -> size of each free block
+  std::map<uint, uint> _freeBlocks;
+  uint _capacity;
+  uint _used = 0;
+
+  void _insertFreeBlock(uint offset, uint size)
+  {
+    auto next = _freeBlocks.lower_bound(offset);
+    if (next != _freeBlocks.begin())
+    {
+      const auto previous = std::prev(next);
+      if (previous->first + previous->second == offset)
+      {
+        offset = previous->first;
+        size += previous->second;
+        _freeBlocks.erase(previous);
+      }
+    }
+    if (next != _freeBlocks.end() && offset + size == next->first)
+    {
+      size += next->second;
+      _freeBlocks.erase(next);
+    }
+    _freeBlocks[offset] = size;
+  }
+
+public:
+  explicit RangeAllocator(const uint capacity) : _capacity(capacity)
+  {
+    if (capacity > 0)
+    {
+      _freeBlocks[0] = capacity;
+    }
+  }
+
+  std::optional<uint> allocate(const uint size)
+  {
+    if (size == 0)
+    {
+      return 0;
+    }
+
+    for (auto block = _freeBlocks.begin(); block != _freeBlocks.end(); ++block)
+    {
+      const auto [offset, blockSize] = *block;
+      if (blockSize < size)
+      {
+        continue;
+      }
+
+      _freeBlocks.erase(block);
+      if (blockSize > size)
+      {
+        _freeBlocks[offset + size] = blockSize - size;
+      }
+      _used += size;
+      return offset;
+    }
+    return std::nullopt;
+  }
+
+  void free(const uint offset, const uint size)
+  {
+    if (size == 0)
+    {
+      return;
+    }
+    _used -= size;
+    _insertFreeBlock(offset, size);
+  }
+
+  // Extends the range, the new space becomes one free block at the end
+  void grow(const uint newCapacity)
+  {
+    if (newCapacity <= _capacity)
+    {
+      return;
+    }
+    _insertFreeBlock(_capacity, newCapacity - _capacity);
+    _capacity = newCapacity;
+  }
+
+  [[nodiscard]] uint capacity() const { return _capacity; }
+  [[nodiscard]] uint used() const { return _used; }
+
+  [[nodiscard]] uint largestFreeBlock() const
+  {
+    uint largest = 0;
+    for (const auto& [offset, size] : _freeBlocks)
+    {
+      largest = std::max(largest, size);
+    }
+    return largest;
+  }
+
+  // 0 when all free space is contiguous, approaching 1 as it is split into small blocks
+  [[nodiscard]] float fragmentation() const
+  {
+    const uint freeUnits = _capacity - _used;
+    if (freeUnits == 0)
+    {
+      return 0.0f;
+    }
+    return 1.0f - static_cast<float>(largestFreeBlock()) / static_cast<float>(freeUnits);
+  }
+};
+
+// A mesh stored inside a GeometryPool. Drawing it only needs the pool's VAO bound.
+struct PooledMesh
+{
+  uint baseVertex, vertexCount;
+  uint firstIndex, indexCount;
+};
+
+struct GeometryPoolStats
+{
+  size_t vertexBytesInUse, vertexBytesCapacity;
+  size_t indexBytesInUse, indexBytesCapacity;
+  float vertexFragmentation, indexFragmentation;
+};
+
+// Suballocates the vertex and index data of many meshes that share a vertex layout from one
+// VBO and one EBO, so they can all be drawn with a single VAO bound. Index ranges are stored
+// relative to the mesh's first vertex and drawn with glDrawElementsBaseVertex.
+class GeometryPool
+{
+  void (*_applyLayout)(); // VertexLayout::apply of the pool's layout
+  // Vertex Array, Vertex and Element Buffer object IDs
+  unsigned int VAO, VBO, EBO, stride;
+  RangeAllocator _vertexRanges, _indexRanges;
+
+  // Replaces `buffer` with a larger one holding the same contents
+  static void _growBuffer(unsigned int& buffer, const size_t oldBytes, const size_t newBytes)
+  {
+    unsigned int newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+
+    if (oldBytes > 0)
+    {
+      glState().bindBuffer(GL_COPY_READ_BUFFER, buffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    }
+
+    glState().deleteBuffer(buffer);
+    buffer = newBuffer;
+  }
+
+  static uint _grownCapacity(const RangeAllocator& ranges, const uint required)
+  {
+    return std::max(ranges.capacity() * 2, ranges.capacity() + required);
+  }
+
+  uint _allocateVertices(const uint count)
+  {
+    if (const auto offset = _vertexRanges.allocate(count))
+    {
+      return *offset;
+    }
+
+    const uint oldCapacity = _vertexRanges.capacity();
+    _vertexRanges.grow(_grownCapacity(_vertexRanges, count));
+    _growBuffer(VBO, static_cast<size_t>(oldCapacity) * stride,
+                static_cast<size_t>(_vertexRanges.capacity()) * stride);
+
+    // The VAO's attribute pointers still refer to the old buffer
+    glState().bindVertexArray(VAO);
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    _applyLayout();
+    return *_vertexRanges.allocate(count);
+  }
+
+  uint _allocateIndices(const uint count)
+  {
+    if (const auto offset = _indexRanges.allocate(count))
+    {
+      return *offset;
+    }
+
+    const uint oldCapacity = _indexRanges.capacity();
+    _indexRanges.grow(_grownCapacity(_indexRanges, count));
+    _growBuffer(EBO, static_cast<size_t>(oldCapacity) * sizeof(uint),
+                static_cast<size_t>(_indexRanges.capacity()) * sizeof(uint));
+
+    // The element buffer binding is part of the VAO state
+    glState().bindVertexArray(VAO);
+    glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    return *_indexRanges.allocate(count);
+  }
+
+public:
+  template <typename... Attrs>
+  explicit GeometryPool(VertexLayout<Attrs...>, const uint vertexCapacity = 1 << 16,
+                        const uint indexCapacity = 1 << 18)
+    : _applyLayout(&VertexLayout<Attrs...>::apply), stride(VertexLayout<Attrs...>::stride),
+      _vertexRanges(vertexCapacity), _indexRanges(indexCapacity)
+  {
+    glGenVertexArrays(1, &VAO);
+    glState().bindVertexArray(VAO);
+
+    glGenBuffers(1, &VBO);
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    _applyLayout();
+    glBufferData(GL_ARRAY_BUFFER, static_cast<size_t>(vertexCapacity) * stride, nullptr, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &EBO);
+    glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<size_t>(indexCapacity) * sizeof(uint), nullptr,
+                 GL_STATIC_DRAW);
+
+    glState().bindVertexArray(0);
+  }
+
+  // Vertex has to fit() the layout the pool was created with
+  template <typename Vertex>
+  PooledMesh add(const std::vector<Vertex>& vertices, const std::vector<uint>& indices)
+  {
+    if (sizeof(Vertex) != stride)
+    {
+      std::cout << "ERROR::GEOMETRY_POOL::VERTICES_DO_NOT_MATCH_LAYOUT" << std::endl;
+      exit(-1);
+    }
+
+    PooledMesh mesh{};
+    mesh.vertexCount = vertices.size();
+    mesh.indexCount = indices.size();
+    mesh.baseVertex = _allocateVertices(mesh.vertexCount);
+    mesh.firstIndex = _allocateIndices(mesh.indexCount);
+
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, static_cast<size_t>(mesh.baseVertex) * stride,
+                    vertices.size() * sizeof(Vertex), vertices.data());
+
+    // Upload through the copy target so the element binding of whichever VAO is bound stays untouched
+    glState().bindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<size_t>(mesh.firstIndex) * sizeof(uint),
+                    indices.size() * sizeof(uint), indices.data());
+    return mesh;
+  }
+
+  // Non-indexed meshes are stored with sequential indices, so every mesh draws the same way
+  template <typename Vertex>
+  PooledMesh add(const std::vector<Vertex>& vertices)
+  {
+    std::vector<uint> indices(vertices.size());
+    for (uint i = 0; i < indices.size(); i++)
+    {
+      indices[i] = i;
+    }
+    return add(vertices, indices);
+  }
+
+  void remove(const PooledMesh& mesh)
+  {
+    _vertexRanges.free(mesh.baseVertex, mesh.vertexCount);
+    _indexRanges.free(mesh.firstIndex, mesh.indexCount);
+  }
+
+  // Must be called before drawing any of the pool's meshes
+  void bind() const
+  {
+    glState().bindVertexArray(VAO);
+  }
+
+  void draw(const PooledMesh& mesh) const
+  {
+    const auto firstIndex = reinterpret_cast<void*>(static_cast<size_t>(mesh.firstIndex) * sizeof(uint));
+    glDrawElementsBaseVertex(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, firstIndex,
+                             static_cast<int>(mesh.baseVertex));
+  }
+
+  [[nodiscard]] GeometryPoolStats stats() const
+  {
+    return {
+      static_cast<size_t>(_vertexRanges.used()) * stride,
+      static_cast<size_t>(_vertexRanges.capacity()) * stride,
+      _indexRanges.used() * sizeof(uint),
+      _indexRanges.capacity() * sizeof(uint),
+      _vertexRanges.fragmentation(),
+      _indexRanges.fragmentation(),
+    };
+  }
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstring>
+
+#include "ext/glad/glad.h"
+
+// The loader in ext/glad stops at core GL 4.0 without extensions, while the window asks for a 3.3
+// context. Newer entry points that we can use when the driver has them are loaded here by
+// initWindow, and stay null otherwise.
+#ifndef GL_TEXTURE_IMMUTABLE_FORMAT
+#define GL_TEXTURE_IMMUTABLE_FORMAT 0x912F
+#endif
+
+typedef void (APIENTRYP PFNTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width,
+                                             GLsizei height);
+typedef void (APIENTRYP PFNTEXSTORAGE3DPROC)(GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width,
+                                             GLsizei height, GLsizei depth);
+
+struct GLExtensions
+{
+  // GL 4.2 / ARB_texture_storage
+  PFNTEXSTORAGE2DPROC texStorage2D = nullptr;
+  PFNTEXSTORAGE3DPROC texStorage3D = nullptr;
+};
+
+inline GLExtensions glExtensions;
+
+// Must be called with a current context
+inline bool hasGLExtension(const char* name)
+{
+  int count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (int i = 0; i < count; i++)
+  {
+    if (std::strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), name) == 0)
+      return true;
+  }
+  return false;
+}
+
+inline void loadGLExtensions(const GLADloadproc load)
+{
+  int major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+  if (major > 4 || (major == 4 && minor >= 2) || hasGLExtension("GL_ARB_texture_storage"))
+  {
+    glExtensions.texStorage2D = reinterpret_cast<PFNTEXSTORAGE2DPROC>(load("glTexStorage2D"));
+    glExtensions.texStorage3D = reinterpret_cast<PFNTEXSTORAGE3DPROC>(load("glTexStorage3D"));
+  }
+}
@@ -0,0 +1,437 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iostream>
+
+#include "ext/glad/glad.h"
+
+typedef unsigned int uint;
+
+// GL calls issued and skipped by the state cache since the last reset
+struct GLStateStats
+{
+  uint64_t calls = 0;
+  uint64_t elided = 0;
+};
+
+// Remembers the GL state the renderer changes and only talks to GL when a value actually changes:
+// the program, the vertex array, non-indexed buffer bindings, texture and sampler bindings of each
+// unit, depth/blend/cull state and the viewport. This only works if every change of that state
+// goes through the cache, so nothing else in the repo calls the wrapped functions directly; state
+// changed behind its back (e.g. by a library) has to be followed by invalidate().
+//
+// GL_ELEMENT_ARRAY_BUFFER isn't cached: its binding belongs to the bound vertex array, so binds
+// always go through. Likewise for texture targets other than 2D, 2D array, 3D and cube maps,
+// and units from TEXTURE_UNITS up.
+//
+// With validation on, every skipped call first checks that GL really has the cached value, and
+// validate() compares all of it. A mismatch is reported and the cache takes GL's value. Queries
+// stall the pipeline, so this is for debugging only.
+class GLStateCache
+{
+public:
+  static constexpr uint TEXTURE_UNITS = 32;
+  // Upload code binds textures here, so it never disturbs what the draws have bound
+  static constexpr uint UPDATE_UNIT = TEXTURE_UNITS - 1;
+
+private:
+  static constexpr uint UNKNOWN = UINT32_MAX;
+
+  static constexpr std::array<GLenum, 5> BUFFER_TARGETS = {
+    GL_ARRAY_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER, GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER};
+  static constexpr std::array<GLenum, 5> BUFFER_BINDINGS = {
+    GL_ARRAY_BUFFER_BINDING, GL_UNIFORM_BUFFER_BINDING, GL_PIXEL_UNPACK_BUFFER_BINDING, GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER};
+  static constexpr std::array<GLenum, 4> TEXTURE_TARGETS = {
+    GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_3D, GL_TEXTURE_CUBE_MAP};
+  static constexpr std::array<GLenum, 4> TEXTURE_BINDINGS = {
+    GL_TEXTURE_BINDING_2D, GL_TEXTURE_BINDING_2D_ARRAY, GL_TEXTURE_BINDING_3D, GL_TEXTURE_BINDING_CUBE_MAP};
+  static constexpr std::array<GLenum, 3> CAPABILITIES = {GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE};
+
+  struct Unit
+  {
+    std::array<uint, TEXTURE_TARGETS.size()> textures{};
+    uint sampler = 0;
+  };
+
+  uint _program = 0;
+  uint _vertexArray = 0;
+  std::array<uint, BUFFER_TARGETS.size()> _buffers{};
+  uint _activeTexture = GL_TEXTURE0;
+  std::array<Unit, TEXTURE_UNITS> _units{};
+  std::array<uint, CAPABILITIES.size()> _capabilities{}; // 0, 1 or UNKNOWN
+  uint _depthFunc = GL_LESS;
+  uint _depthMask = GL_TRUE;
+  uint _blendSource = GL_ONE, _blendDestination = GL_ZERO;
+  uint _cullFace = GL_BACK;
+  std::array<int, 4> _viewport = {-1, -1, -1, -1}; // Set by initWindow
+
+  bool _validate = false;
+  GLStateStats _stats;
+
+  template <size_t N>
+  static int _indexOf(const std::array<GLenum, N>& values, const GLenum value)
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      if (values[i] == value)
+        return static_cast<int>(i);
+    }
+    return -1;
+  }
+
+  // Compares cached with GL's value of pname, reports and adopts GL's value if they differ
+  void _check(const GLenum pname, uint& cached, const char* name)
+  {
+    int actual;
+    glGetIntegerv(pname, &actual);
+    if (cached != UNKNOWN && static_cast<uint>(actual) != cached)
+    {
+      std::cout << "ERROR::GL_STATE::DRIFT " << name << ": cached " << cached << ", GL has " << actual << std::endl;
+    }
+    cached = static_cast<uint>(actual);
+  }
+
+  // Same for state of a texture unit, which the queries read from the active unit. Leaves the unit active.
+  void _checkUnit(const uint unit, const GLenum pname, uint& cached, const char* name)
+  {
+    if (GL_TEXTURE0 + unit != _activeTexture)
+    {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      _activeTexture = GL_TEXTURE0 + unit;
+    }
+    _check(pname, cached, name);
+  }
+
+  // Counts a call, returns true if it can be skipped
+  bool _elide(const bool unchanged)
+  {
+    if (unchanged)
+    {
+      _stats.elided++;
+      return true;
+    }
+    _stats.calls++;
+    return false;
+  }
+
+  void _activate(const uint unit)
+  {
+    const uint texture = GL_TEXTURE0 + unit;
+    if (_validate && texture == _activeTexture)
+      _check(GL_ACTIVE_TEXTURE, _activeTexture, "active texture");
+    if (_elide(texture == _activeTexture))
+      return;
+    glActiveTexture(texture);
+    _activeTexture = texture;
+  }
+
+public:
+  // Debug mode, see the class comment
+  void setValidation(const bool enabled) { _validate = enabled; }
+
+  void useProgram(const uint program)
+  {
+    if (_validate && program == _program)
+      _check(GL_CURRENT_PROGRAM, _program, "program");
+    if (_elide(program == _program))
+      return;
+    glUseProgram(program);
+    _program = program;
+  }
+
+  void bindVertexArray(const uint vertexArray)
+  {
+    if (_validate && vertexArray == _vertexArray)
+      _check(GL_VERTEX_ARRAY_BINDING, _vertexArray, "vertex array");
+    if (_elide(vertexArray == _vertexArray))
+      return;
+    glBindVertexArray(vertexArray);
+    _vertexArray = vertexArray;
+  }
+
+  void bindBuffer(const GLenum target, const uint buffer)
+  {
+    const int index = _indexOf(BUFFER_TARGETS, target);
+    if (index < 0)
+    {
+      _stats.calls++;
+      glBindBuffer(target, buffer);
+      return;
+    }
+    if (_validate && buffer == _buffers[index])
+      _check(BUFFER_BINDINGS[index], _buffers[index], "buffer");
+    if (_elide(buffer == _buffers[index]))
+      return;
+    glBindBuffer(target, buffer);
+    _buffers[index] = buffer;
+  }
+
+  // Indexed bindings aren't cached, but they also bind the buffer to the generic target
+  void bindBufferBase(const GLenum target, const uint index, const uint buffer)
+  {
+    _stats.calls++;
+    glBindBufferBase(target, index, buffer);
+    if (const int i = _indexOf(BUFFER_TARGETS, target); i >= 0)
+      _buffers[i] = buffer;
+  }
+
+  // Deleting a buffer unbinds it
+  void deleteBuffer(const uint buffer)
+  {
+    glDeleteBuffers(1, &buffer);
+    for (uint& bound : _buffers)
+    {
+      if (bound == buffer)
+        bound = 0;
+    }
+  }
+
+  void bindTexture(const uint unit, const GLenum target, const uint texture)
+  {
+    const int index = _indexOf(TEXTURE_TARGETS, target);
+    if (index < 0 || unit >= TEXTURE_UNITS)
+    {
+      _activate(unit);
+      _stats.calls++;
+      glBindTexture(target, texture);
+      return;
+    }
+
+    uint& bound = _units[unit].textures[index];
+    if (_validate && texture == bound)
+      _checkUnit(unit, TEXTURE_BINDINGS[index], bound, "texture");
+    if (texture == bound)
+    {
+      _stats.elided += 2; // No need to select the unit either
+      return;
+    }
+    _activate(unit);
+    _stats.calls++;
+    glBindTexture(target, texture);
+    bound = texture;
+  }
+
+  // For creating and uploading textures: binds on UPDATE_UNIT and leaves it active, so the
+  // glTex* calls that follow act on this texture
+  void bindTextureForUpdate(const GLenum target, const uint texture)
+  {
+    _activate(UPDATE_UNIT);
+    bindTexture(UPDATE_UNIT, target, texture);
+  }
+
+  // Sampler bindings are indexed by unit and don't depend on the active one
+  void bindSampler(const uint unit, const uint sampler)
+  {
+    if (unit >= TEXTURE_UNITS)
+    {
+      _stats.calls++;
+      glBindSampler(unit, sampler);
+      return;
+    }
+    uint& bound = _units[unit].sampler;
+    if (_validate && sampler == bound)
+      _checkUnit(unit, GL_SAMPLER_BINDING, bound, "sampler");
+    if (_elide(sampler == bound))
+      return;
+    glBindSampler(unit, sampler);
+    bound = sampler;
+  }
+
+  // Deleting a texture unbinds it from every unit
+  void deleteTexture(const uint texture)
+  {
+    glDeleteTextures(1, &texture);
+    for (Unit& unit : _units)
+    {
+      for (uint& bound : unit.textures)
+      {
+        if (bound == texture)
+          bound = 0;
+      }
+    }
+  }
+
+  // GL_DEPTH_TEST, GL_BLEND and GL_CULL_FACE are cached, other capabilities go straight to GL
+  void setEnabled(const GLenum capability, const bool enabled)
+  {
+    const int index = _indexOf(CAPABILITIES, capability);
+    if (index >= 0)
+    {
+      uint& cached = _capabilities[index];
+      if (_validate && cached == static_cast<uint>(enabled))
+      {
+        const uint actual = glIsEnabled(capability);
+        if (actual != cached)
+          std::cout << "ERROR::GL_STATE::DRIFT capability " << capability << ": cached " << cached << ", GL has "
+                    << actual << std::endl;
+        cached = actual;
+      }
+      if (_elide(cached == static_cast<uint>(enabled)))
+        return;
+      cached = enabled;
+    }
+    else
+    {
+      _stats.calls++;
+    }
+
+    if (enabled)
+      glEnable(capability);
+    else
+      glDisable(capability);
+  }
+
+  void enable(const GLenum capability) { setEnabled(capability, true); }
+  void disable(const GLenum capability) { setEnabled(capability, false); }
+
+  void depthFunc(const GLenum func)
+  {
+    if (_validate && func == _depthFunc)
+      _check(GL_DEPTH_FUNC, _depthFunc, "depth func");
+    if (_elide(func == _depthFunc))
+      return;
+    glDepthFunc(func);
+    _depthFunc = func;
+  }
+
+  void depthMask(const bool write)
+  {
+    if (_validate && static_cast<uint>(write) == _depthMask)
+      _check(GL_DEPTH_WRITEMASK, _depthMask, "depth mask");
+    if (_elide(static_cast<uint>(write) == _depthMask))
+      return;
+    glDepthMask(write);
+    _depthMask = write;
+  }
+
+  // Same factors for colour and alpha
+  void blendFunc(const GLenum source, const GLenum destination)
+  {
+    if (_validate && source == _blendSource && destination == _blendDestination)
+    {
+      _check(GL_BLEND_SRC_RGB, _blendSource, "blend source");
+      _check(GL_BLEND_DST_RGB, _blendDestination, "blend destination");
+    }
+    if (_elide(source == _blendSource && destination == _blendDestination))
+      return;
+    glBlendFunc(source, destination);
+    _blendSource = source;
+    _blendDestination = destination;
+  }
+
+  void cullFace(const GLenum face)
+  {
+    if (_validate && face == _cullFace)
+      _check(GL_CULL_FACE_MODE, _cullFace, "cull face");
+    if (_elide(face == _cullFace))
+      return;
+    glCullFace(face);
+    _cullFace = face;
+  }
+
+  void viewport(const int x, const int y, const int width, const int height)
+  {
+    const std::array viewport = {x, y, width, height};
+    if (_validate && viewport == _viewport)
+    {
+      std::array<int, 4> actual{};
+      glGetIntegerv(GL_VIEWPORT, actual.data());
+      if (actual != _viewport)
+        std::cout << "ERROR::GL_STATE::DRIFT viewport" << std::endl;
+      _viewport = actual;
+    }
+    if (_elide(viewport == _viewport))
+      return;
+    glViewport(x, y, width, height);
+    _viewport = viewport;
+  }
+
+  // Compares all of the cached state with GL, e.g. once per frame in debug builds. Returns false
+  // and reports every value that drifted.
+  bool validate()
+  {
+    const GLStateStats stats = _stats;
+    bool valid = true;
+    const auto check = [&](const GLenum pname, uint& cached, const char* name) {
+      const uint before = cached;
+      _check(pname, cached, name);
+      valid &= before == UNKNOWN || before == cached;
+    };
+
+    check(GL_CURRENT_PROGRAM, _program, "program");
+    check(GL_VERTEX_ARRAY_BINDING, _vertexArray, "vertex array");
+    for (size_t i = 0; i < BUFFER_TARGETS.size(); i++)
+    {
+      check(BUFFER_BINDINGS[i], _buffers[i], "buffer");
+    }
+
+    check(GL_ACTIVE_TEXTURE, _activeTexture, "active texture");
+    const uint activeTexture = _activeTexture;
+    for (uint unit = 0; unit < TEXTURE_UNITS; unit++)
+    {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      for (size_t i = 0; i < TEXTURE_TARGETS.size(); i++)
+      {
+        check(TEXTURE_BINDINGS[i], _units[unit].textures[i], "texture");
+      }
+      check(GL_SAMPLER_BINDING, _units[unit].sampler, "sampler");
+    }
+    glActiveTexture(activeTexture);
+
+    for (size_t i = 0; i < CAPABILITIES.size(); i++)
+    {
+      const uint actual = glIsEnabled(CAPABILITIES[i]);
+      if (_capabilities[i] != UNKNOWN && _capabilities[i] != actual)
+      {
+        std::cout << "ERROR::GL_STATE::DRIFT capability " << CAPABILITIES[i] << ": cached " << _capabilities[i]
+                  << ", GL has " << actual << std::endl;
+        valid = false;
+      }
+      _capabilities[i] = actual;
+    }
+    check(GL_DEPTH_FUNC, _depthFunc, "depth func");
+    check(GL_DEPTH_WRITEMASK, _depthMask, "depth mask");
+    check(GL_BLEND_SRC_RGB, _blendSource, "blend source");
+    check(GL_BLEND_DST_RGB, _blendDestination, "blend destination");
+    check(GL_CULL_FACE_MODE, _cullFace, "cull face");
+
+    std::array<int, 4> viewport{};
+    glGetIntegerv(GL_VIEWPORT, viewport.data());
+    if (_viewport[2] >= 0 && viewport != _viewport)
+    {
+      std::cout << "ERROR::GL_STATE::DRIFT viewport" << std::endl;
+      valid = false;
+    }
+    _viewport = viewport;
+
+    _stats = stats; // The queries above aren't renderer calls
+    return valid;
+  }
+
+  // Forgets everything, the next change of each state goes to GL
+  void invalidate()
+  {
+    _program = _vertexArray = UNKNOWN;
+    _buffers.fill(UNKNOWN);
+    _activeTexture = UNKNOWN;
+    for (Unit& unit : _units)
+    {
+      unit.textures.fill(UNKNOWN);
+      unit.sampler = UNKNOWN;
+    }
+    _capabilities.fill(UNKNOWN);
+    _depthFunc = _depthMask = _blendSource = _blendDestination = _cullFace = UNKNOWN;
+    _viewport = {-1, -1, -1, -1};
+  }
+
+  [[nodiscard]] const GLStateStats& stats() const { return _stats; }
+  void resetStats() { _stats = {}; }
+};
+
+// The cache of the one GL context the demos create. Only use it on the GL thread.
+inline GLStateCache& glState()
+{
+  static GLStateCache cache;
+  return cache;
+}
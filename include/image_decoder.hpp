@@ -0,0 +1,288 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "lock_free_queue.hpp"
+#include "mipmap_generator.hpp"
+
+#include "ext/stb_image.h"
+
+typedef unsigned int uint;
+
+struct DecodedImage
+{
+  uint id = 0;                    // Whatever the caller submitted the image with, e.g. a texture ID
+  std::string path;
+  unsigned char* pixels = nullptr; // nullptr if decoding failed, release with stbi_image_free
+  int width = 0, height = 0, channels = 0;
+  std::vector<MipLevel> mipLevels; // Levels 1 and up, if the decoder was asked to generate them
+  bool inSink = false;             // Every level went into the job's ImageSink, pixels is nullptr
+
+  [[nodiscard]] bool failed() const { return pixels == nullptr && !inSink; }
+};
+
+// Memory a decoder job writes its pixels to instead of handing them back, e.g. a mapped pixel
+// unpack buffer. The base level and the mip levels are written back to back, each starting
+// 4-byte aligned, rows tightly packed and the bottom row first as OpenGL expects. Flipping and
+// padding to RGBA happen in the same pass that fills the sink.
+struct ImageSink
+{
+  unsigned char* data;
+  size_t capacity;
+};
+
+// Bytes a level takes in an ImageSink or a pixel unpack buffer laid out the same way
+inline size_t alignedLevelSize(const int width, const int height, const int channels)
+{
+  return (static_cast<size_t>(width) * height * channels + 3) & ~static_cast<size_t>(3);
+}
+
+// Decodes images with stb_image on a pool of worker threads. Jobs go in under a mutex, which
+// only the (rare) submissions and idle workers touch; decoded images come back through a
+// lock-free queue, so the thread polling for results never blocks on the workers.
+class ImageDecoder
+{
+  struct Job
+  {
+    uint id;
+    std::string path;
+    std::optional<ImageSink> sink;
+  };
+
+  std::vector<std::thread> _workers;
+  std::mutex _jobMutex;
+  std::condition_variable _jobAvailable;
+  std::deque<Job> _jobs;
+  std::atomic<bool> _stopping{false}; // Written under _jobMutex, also read by workers waiting to push a result
+
+  LockFreeQueue<DecodedImage> _results;
+  std::atomic<size_t> _pending{0};
+  const std::optional<MipOptions> _mipOptions;
+  const bool _padToRgba;
+
+  // RGB to RGBA with opaque alpha. stb_image can do this itself, but only for every image at once.
+  static void _padPixels(DecodedImage& image)
+  {
+    const size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    auto* padded = static_cast<unsigned char*>(malloc(pixelCount * 4));
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+      padded[i * 4] = image.pixels[i * 3];
+      padded[i * 4 + 1] = image.pixels[i * 3 + 1];
+      padded[i * 4 + 2] = image.pixels[i * 3 + 2];
+      padded[i * 4 + 3] = 255;
+    }
+    stbi_image_free(image.pixels);
+    image.pixels = padded;
+    image.channels = 4;
+  }
+
+  // Copies a level into the sink upside down, padding RGB to RGBA on the way if needed
+  static void _writeFlipped(const unsigned char* pixels, const int width, const int height, const int channels,
+                            unsigned char* target, const int targetChannels)
+  {
+    const size_t rowBytes = static_cast<size_t>(width) * channels;
+    const size_t targetRowBytes = static_cast<size_t>(width) * targetChannels;
+    for (int y = 0; y < height; y++)
+    {
+      const unsigned char* source = pixels + (height - 1 - y) * rowBytes;
+      unsigned char* row = target + y * targetRowBytes;
+      if (channels == targetChannels)
+      {
+        std::memcpy(row, source, rowBytes);
+        continue;
+      }
+      for (int x = 0; x < width; x++)
+      {
+        row[x * 4] = source[x * 3];
+        row[x * 4 + 1] = source[x * 3 + 1];
+        row[x * 4 + 2] = source[x * 3 + 2];
+        row[x * 4 + 3] = 255;
+      }
+    }
+  }
+
+  // The image is decoded top row first and only flipped while it is copied into the sink, which
+  // saves stb_image's separate flipping pass. The mips are generated from the unflipped image;
+  // with the box filter that only differs from filtering the flipped one for odd heights, where
+  // the dropped row is at the other end.
+  void _decodeIntoSink(const ImageSink& sink, DecodedImage& image) const
+  {
+    int channels;
+    unsigned char* pixels = stbi_load(image.path.c_str(), &image.width, &image.height, &channels, 0);
+    if (pixels == nullptr)
+      return;
+
+    const int targetChannels = outputChannels(channels);
+    if (sinkSize(image.width, image.height, channels) > sink.capacity)
+    {
+      // The file changed since the sink was sized for it
+      std::cout << "ERROR::IMAGE_DECODER::SINK_TOO_SMALL " << image.path << std::endl;
+      stbi_image_free(pixels);
+      return;
+    }
+
+    std::vector<MipLevel> mipLevels;
+    if (_mipOptions)
+      mipLevels = generateMipLevels(pixels, image.width, image.height, channels, *_mipOptions);
+
+    _writeFlipped(pixels, image.width, image.height, channels, sink.data, targetChannels);
+    size_t offset = alignedLevelSize(image.width, image.height, targetChannels);
+    for (const MipLevel& level : mipLevels)
+    {
+      _writeFlipped(level.pixels.data(), level.width, level.height, channels, sink.data + offset, targetChannels);
+      offset += alignedLevelSize(level.width, level.height, targetChannels);
+    }
+
+    stbi_image_free(pixels);
+    image.channels = targetChannels;
+    image.inSink = true;
+  }
+
+  void _work()
+  {
+    while (true)
+    {
+      Job job;
+      {
+        std::unique_lock lock(_jobMutex);
+        _jobAvailable.wait(lock, [this] { return _stopping || !_jobs.empty(); });
+        if (_stopping)
+          return;
+        job = std::move(_jobs.front());
+        _jobs.pop_front();
+      }
+
+      DecodedImage image;
+      image.id = job.id;
+      image.path = std::move(job.path);
+      // OpenGL expects the first row of pixels at the bottom, images store it at the top. The
+      // flag is per thread; sink jobs flip while copying instead.
+      stbi_set_flip_vertically_on_load_thread(!job.sink);
+      if (job.sink)
+      {
+        _decodeIntoSink(*job.sink, image);
+      }
+      else
+      {
+        image.pixels = stbi_load(image.path.c_str(), &image.width, &image.height, &image.channels, 0);
+        if (image.pixels != nullptr && _padToRgba && image.channels == 3)
+        {
+          _padPixels(image);
+        }
+        if (image.pixels != nullptr && _mipOptions)
+        {
+          image.mipLevels = generateMipLevels(image.pixels, image.width, image.height, image.channels, *_mipOptions);
+        }
+      }
+
+      // The consumer is behind, give it a chance to catch up. Nobody will collect the image once
+      // the decoder is being destroyed.
+      while (!_results.tryPush(std::move(image)))
+      {
+        if (_stopping)
+        {
+          stbi_image_free(image.pixels);
+          return;
+        }
+        std::this_thread::yield();
+      }
+    }
+  }
+
+public:
+  // With mipOptions, the workers also generate the mip chain of every image they decode.
+  // padToRgba turns 3 channel images into 4 channel ones with opaque alpha.
+  explicit ImageDecoder(const uint threadCount = std::max(1u, std::thread::hardware_concurrency()),
+                        const size_t resultCapacity = 1024,
+                        const std::optional<MipOptions> mipOptions = std::nullopt, const bool padToRgba = false)
+    : _results(resultCapacity), _mipOptions(mipOptions), _padToRgba(padToRgba)
+  {
+    for (uint i = 0; i < threadCount; i++)
+    {
+      _workers.emplace_back(&ImageDecoder::_work, this);
+    }
+  }
+
+  ImageDecoder(const ImageDecoder&) = delete;
+  ImageDecoder& operator=(const ImageDecoder&) = delete;
+
+  // Jobs that haven't started are dropped, decoded images nobody collected are freed
+  ~ImageDecoder()
+  {
+    stop();
+    DecodedImage image;
+    while (_results.tryPop(image))
+    {
+      stbi_image_free(image.pixels);
+    }
+  }
+
+  // Waits for the images being decoded and drops the jobs that haven't started. No sink is written
+  // to once this returns; results that were already queued can still be collected.
+  void stop()
+  {
+    {
+      std::lock_guard lock(_jobMutex);
+      _stopping = true;
+    }
+    _jobAvailable.notify_all();
+    for (std::thread& worker : _workers)
+    {
+      worker.join();
+    }
+    _workers.clear();
+  }
+
+  // With a sink, the pixels go there and the result only reports the image's size. The sink
+  // must stay writable until the result has been collected.
+  void submit(const uint id, std::string path, const std::optional<ImageSink> sink = std::nullopt)
+  {
+    _pending++;
+    {
+      std::lock_guard lock(_jobMutex);
+      _jobs.push_back({id, std::move(path), sink});
+    }
+    _jobAvailable.notify_one();
+  }
+
+  // Channels the decoder hands back for an image with the given channel count
+  [[nodiscard]] int outputChannels(const int channels) const { return _padToRgba && channels == 3 ? 4 : channels; }
+
+  // Bytes a sink needs for an image of the given size, mip levels included
+  [[nodiscard]] size_t sinkSize(int width, int height, const int channels) const
+  {
+    const int targetChannels = outputChannels(channels);
+    size_t size = alignedLevelSize(width, height, targetChannels);
+    while (_mipOptions && (width > 1 || height > 1))
+    {
+      width = std::max(1, width / 2);
+      height = std::max(1, height / 2);
+      size += alignedLevelSize(width, height, targetChannels);
+    }
+    return size;
+  }
+
+  // Never blocks. The caller owns the returned pixels.
+  bool tryGetResult(DecodedImage& image)
+  {
+    if (!_results.tryPop(image))
+      return false;
+    _pending--;
+    return true;
+  }
+
+  // Images submitted but not collected yet
+  [[nodiscard]] size_t pending() const { return _pending.load(); }
+  [[nodiscard]] size_t threadCount() const { return _workers.size(); }
+};
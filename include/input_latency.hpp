@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "ext/glad/glad.h"
+#include "GLFW/glfw3.h"
+
+typedef unsigned int uint;
+
+// Input to present latency over the frames measured since the last reset, in milliseconds
+struct InputLatencyStats
+{
+  uint64_t frames = 0;
+  double averageMs = 0.0;
+  double maxMs = 0.0;
+};
+
+// Measures how old the input a frame was rendered with is by the time the GPU finishes the frame.
+// A GL_TIMESTAMP query is written after the frame's last command, and read back a few frames
+// later without waiting on it. GPU timestamps are converted to glfwGetTime() seconds with an
+// offset taken when the meter is created or reset. The frame reaches the screen at the next
+// vblank after that, so on top of this comes up to one refresh interval with vsync.
+class InputLatencyMeter
+{
+  struct Frame
+  {
+    uint query = 0;
+    double inputTime = 0.0;
+    bool pending = false;
+  };
+
+  std::vector<Frame> _frames;
+  size_t _next = 0;
+  double _gpuToCpuOffset = 0.0; // Seconds to add to a GPU timestamp to get glfwGetTime() time
+  InputLatencyStats _stats;
+  double _totalMs = 0.0;
+
+  void _calibrate()
+  {
+    GLint64 gpuTime;
+    glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+    _gpuToCpuOffset = glfwGetTime() - static_cast<double>(gpuTime) * 1e-9;
+  }
+
+  void _collect()
+  {
+    for (Frame& frame : _frames)
+    {
+      if (!frame.pending)
+        continue;
+      int available;
+      glGetQueryObjectiv(frame.query, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+        continue;
+
+      GLuint64 gpuTime;
+      glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &gpuTime);
+      frame.pending = false;
+      const double latencyMs = (static_cast<double>(gpuTime) * 1e-9 + _gpuToCpuOffset - frame.inputTime) * 1000.0;
+      _stats.frames++;
+      _totalMs += latencyMs;
+      _stats.maxMs = std::max(_stats.maxMs, latencyMs);
+    }
+  }
+
+public:
+  // depth is the number of frames that can be in flight before one goes unmeasured
+  explicit InputLatencyMeter(const size_t depth = 4) : _frames(depth)
+  {
+    for (Frame& frame : _frames)
+    {
+      glGenQueries(1, &frame.query);
+    }
+    _calibrate();
+  }
+
+  // Deletes the queries, so the meter has to go before the context does
+  ~InputLatencyMeter()
+  {
+    for (const Frame& frame : _frames)
+    {
+      glDeleteQueries(1, &frame.query);
+    }
+  }
+
+  InputLatencyMeter(const InputLatencyMeter&) = delete;
+  InputLatencyMeter& operator=(const InputLatencyMeter&) = delete;
+
+  // Call after the frame's last draw, before swapping. inputTime is the glfwGetTime() at which the
+  // input the frame's camera was built from was polled.
+  void frameSubmitted(const double inputTime)
+  {
+    _collect();
+    Frame& frame = _frames[_next];
+    // The GPU is more than depth frames behind, skip this one rather than wait
+    if (frame.pending)
+      return;
+    glQueryCounter(frame.query, GL_TIMESTAMP);
+    frame.inputTime = inputTime;
+    frame.pending = true;
+    _next = (_next + 1) % _frames.size();
+  }
+
+  [[nodiscard]] InputLatencyStats stats() const
+  {
+    InputLatencyStats stats = _stats;
+    if (stats.frames > 0)
+      stats.averageMs = _totalMs / static_cast<double>(stats.frames);
+    return stats;
+  }
+
+  // Also re-synchronises the clocks, which drift apart over time
+  void resetStats()
+  {
+    _stats = {};
+    _totalMs = 0.0;
+    _calibrate();
+  }
+};
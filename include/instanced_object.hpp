@@ -0,0 +1,119 @@
+#pragma once
+#include <iostream>
+#include <vector>
+
+#include "opengl_object.hpp"
+
+#include "ext/glm/glm.hpp"
+
+// An OpenGLObject that is drawn many times with a single instanced draw call.
+// Each instance gets its own model matrix (and optionally a colour) through
+// per-instance vertex attributes instead of a uniform upload per draw.
+class InstancedOpenGLObject : public OpenGLObject
+{
+  // A mat4 attribute takes up four consecutive locations, one per column
+  static constexpr uint MATRIX_COLUMNS = 4;
+
+  unsigned int _matrixVBO = 0, _colourVBO = 0;
+  uint _matrixLocation;
+  uint _instanceCount = 0;
+  uint _matrixCapacity = 0, _colourCapacity = 0;
+
+  void _initInstanceVBOs(const bool perInstanceColour)
+  {
+    glState().bindVertexArray(VAO);
+
+    glGenBuffers(1, &_matrixVBO);
+    glState().bindBuffer(GL_ARRAY_BUFFER, _matrixVBO);
+    for (uint column = 0; column < MATRIX_COLUMNS; column++)
+    {
+      const uint location = _matrixLocation + column;
+      const auto offset = reinterpret_cast<void*>(column * sizeof(glm::vec4));
+      glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), offset);
+      glEnableVertexAttribArray(location);
+      glVertexAttribDivisor(location, 1);
+    }
+
+    if (perInstanceColour)
+    {
+      const uint location = colourLocation();
+      glGenBuffers(1, &_colourVBO);
+      glState().bindBuffer(GL_ARRAY_BUFFER, _colourVBO);
+      glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+      glEnableVertexAttribArray(location);
+      glVertexAttribDivisor(location, 1);
+    }
+
+    glState().bindVertexArray(0);
+  }
+
+  // Re-specifies the buffer when it needs to grow, otherwise orphans the old storage
+  // so the driver does not have to wait for in-flight draws still reading it.
+  static void _streamData(const unsigned int buffer, uint& capacity, const void* data, const uint size)
+  {
+    glState().bindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (size > capacity)
+    {
+      capacity = size;
+    }
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+  }
+
+public:
+  // Per-vertex semantics use locations 0-3, see vertex_layout.hpp
+  static constexpr uint DEFAULT_MATRIX_LOCATION = 4;
+
+  template <typename Vertex, typename... Attrs>
+  InstancedOpenGLObject(const std::vector<Vertex>& vertices, const VertexLayout<Attrs...> layout,
+                        const bool perInstanceColour = false,
+                        const uint matrixLocation = DEFAULT_MATRIX_LOCATION)
+    : OpenGLObject(vertices, layout), _matrixLocation(matrixLocation)
+  {
+    _initInstanceVBOs(perInstanceColour);
+  }
+
+  template <typename Vertex, typename... Attrs>
+  InstancedOpenGLObject(const std::vector<Vertex>& vertices, const std::vector<uint>& indices,
+                        const VertexLayout<Attrs...> layout, const bool perInstanceColour = false,
+                        const uint matrixLocation = DEFAULT_MATRIX_LOCATION)
+    : OpenGLObject(vertices, indices, layout), _matrixLocation(matrixLocation)
+  {
+    _initInstanceVBOs(perInstanceColour);
+  }
+
+  // The colour attribute sits right after the four matrix columns
+  [[nodiscard]] uint colourLocation() const { return _matrixLocation + MATRIX_COLUMNS; }
+  [[nodiscard]] uint instanceCount() const { return _instanceCount; }
+
+  void setInstances(const std::vector<glm::mat4>& models)
+  {
+    _instanceCount = models.size();
+    _streamData(_matrixVBO, _matrixCapacity, models.data(), models.size() * sizeof(glm::mat4));
+  }
+
+  void setInstanceColours(const std::vector<glm::vec3>& colours)
+  {
+    if (_colourVBO == 0)
+    {
+      std::cout << "ERROR::INSTANCED_OBJECT::CREATED_WITHOUT_PER_INSTANCE_COLOUR" << std::endl;
+      return;
+    }
+    _streamData(_colourVBO, _colourCapacity, colours.data(), colours.size() * sizeof(glm::vec3));
+  }
+
+  void draw() const
+  {
+    if (_instanceCount == 0)
+    {
+      return;
+    }
+
+    glState().bindVertexArray(VAO);
+    if (_indexCount > 0) {
+      glDrawElementsInstanced(GL_TRIANGLES, _indexCount, _indexType, nullptr, _instanceCount);
+    } else {
+      glDrawArraysInstanced(GL_TRIANGLES, 0, vertexCount(), _instanceCount);
+    }
+  }
+};
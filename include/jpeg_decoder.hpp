@@ -0,0 +1,618 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+typedef unsigned int uint;
+
+// Baseline JPEG decoder that can scale by 1/2, 1/4 or 1/8 while decoding. A JPEG stores 8x8
+// blocks of DCT coefficients; the top-left NxN coefficients of a block are the block's content
+// low-pass filtered to N/8 of its size, so an N-point inverse DCT of just those gives the block
+// downscaled. Entropy decoding still has to walk every coefficient, but dequantisation, the IDCT,
+// colour conversion and the output all shrink by the square of the scale, and there is no
+// full-size image to downsample afterwards. This is how libjpeg's scale_denom works.
+//
+// Only baseline and extended sequential Huffman coded 8-bit files with one or three components
+// are supported, which covers what image editors write by default; progressive and arithmetic
+// coded files, CMYK and 12-bit precision make decodeJpeg return false, so callers can fall back
+// to stb_image. Chroma is upsampled by replication.
+//
+// The decoder is standalone: only jpeg_scaled_decode_benchmark uses it. ImageDecoder and
+// TextureLoader decode every image at full size with stb_image, which is faster at 1/1, and
+// TextureStreamer streams levels from baked files, which already contain the low mips.
+struct JpegImage
+{
+  int width = 0, height = 0, channels = 0; // channels is 1 or 3
+  std::vector<unsigned char> pixels;       // Top row first, like stb_image without flipping
+};
+
+// Natural (row major) position of the coefficient at each zigzag index
+constexpr uint8_t JPEG_ZIGZAG[64] = {
+  0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+  41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+  30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// Huffman codes up to this long are decoded with a single table lookup
+constexpr int JPEG_FAST_BITS = 9;
+
+struct _JpegHuffman
+{
+  bool defined = false;
+  std::array<uint16_t, 1 << JPEG_FAST_BITS> fast{}; // (length << 8) | symbol for short codes, 0 otherwise
+  std::array<int32_t, 17> maxCode{};           // Largest code of each length, -1 if there is none
+  std::array<int32_t, 17> valueOffset{};       // Symbol index of a code minus the code
+  std::array<uint8_t, 256> symbols{};
+  // For AC tables, short codes whose extra bits fit in the lookup as well:
+  // (value << 8) | (run << 4) | total length, 0 otherwise
+  std::array<int16_t, 1 << JPEG_FAST_BITS> fastAc{};
+
+  // counts[i] is the number of codes of length i + 1
+  bool build(const uint8_t* counts, const uint8_t* values, const int valueCount)
+  {
+    std::copy(values, values + valueCount, symbols.begin());
+    fast.fill(0);
+    int code = 0, index = 0;
+    for (int length = 1; length <= 16; length++)
+    {
+      // More codes than the length has room for, checked before they go in the lookup
+      if (code + counts[length - 1] > 1 << length)
+        return false;
+      valueOffset[length] = index - code;
+      for (int i = 0; i < counts[length - 1]; i++, code++, index++)
+      {
+        if (length <= JPEG_FAST_BITS)
+        {
+          const int shift = JPEG_FAST_BITS - length;
+          for (int fill = 0; fill < 1 << shift; fill++)
+          {
+            fast[(code << shift) | fill] = static_cast<uint16_t>(length << 8 | symbols[index]);
+          }
+        }
+      }
+      maxCode[length] = counts[length - 1] > 0 ? code - 1 : -1;
+      code <<= 1;
+    }
+
+    fastAc.fill(0);
+    for (int bits = 0; bits < 1 << JPEG_FAST_BITS; bits++)
+    {
+      const int length = fast[bits] >> 8;
+      const int run = fast[bits] >> 4 & 15, category = fast[bits] & 15;
+      if (length == 0 || category == 0 || length + category > JPEG_FAST_BITS)
+        continue;
+      const int extra = bits >> (JPEG_FAST_BITS - length - category) & ((1 << category) - 1);
+      const int value = extra < 1 << (category - 1) ? extra - (1 << category) + 1 : extra;
+      if (value < -128 || value > 127) // Doesn't fit the upper byte, decoded the slow way
+        continue;
+      fastAc[bits] = static_cast<int16_t>(value * 256 + (run << 4) + length + category);
+    }
+    defined = true;
+    return true;
+  }
+};
+
+// Reads the entropy coded data of a scan. Stuffed zero bytes are dropped; at a marker the reader
+// stops and feeds zeros, which is what the padding at the end of a scan decodes as anyway.
+struct _JpegBitReader
+{
+  const uint8_t* data;
+  size_t size;
+  size_t position;
+  uint64_t buffer = 0; // The next bits, most significant first
+  int bits = 0;
+  int marker = -1;
+  size_t markerPosition = 0;
+
+  void fill()
+  {
+    // Usually the next 8 bytes have no 0xFF among them and go in at once
+    if (marker < 0 && position + 8 <= size)
+    {
+      uint64_t word;
+      std::memcpy(&word, data + position, sizeof(word));
+      const uint64_t inverted = ~word;
+      if (((inverted - 0x0101010101010101ull) & ~inverted & 0x8080808080808080ull) == 0)
+      {
+        const int count = (64 - bits) / 8;
+        const int filled = bits + 8 * count;
+        const uint64_t mask = filled == 64 ? ~0ull : ~(~0ull >> filled);
+        buffer |= (__builtin_bswap64(word) >> bits) & mask;
+        bits = filled;
+        position += count;
+        return;
+      }
+    }
+
+    while (bits <= 56)
+    {
+      uint8_t byte = 0;
+      if (marker < 0 && position < size)
+      {
+        byte = data[position];
+        if (byte != 0xFF)
+        {
+          position++;
+        }
+        else if (position + 1 < size && data[position + 1] == 0x00)
+        {
+          position += 2;
+        }
+        else
+        {
+          markerPosition = position;
+          marker = position + 1 < size ? data[position + 1] : 0xD9;
+          byte = 0;
+        }
+      }
+      buffer |= static_cast<uint64_t>(byte) << (56 - bits);
+      bits += 8;
+    }
+  }
+
+  uint32_t peek(const int count)
+  {
+    if (bits < count)
+      fill();
+    return static_cast<uint32_t>(buffer >> (64 - count));
+  }
+
+  void consume(const int count)
+  {
+    buffer <<= count;
+    bits -= count;
+  }
+
+  int decode(const _JpegHuffman& table)
+  {
+    if (bits < 16)
+      fill();
+    const uint16_t entry = table.fast[buffer >> (64 - JPEG_FAST_BITS)];
+    if (entry != 0)
+    {
+      consume(entry >> 8);
+      return entry & 0xFF;
+    }
+    for (int length = JPEG_FAST_BITS + 1; length <= 16; length++)
+    {
+      const auto code = static_cast<int32_t>(buffer >> (64 - length));
+      if (code <= table.maxCode[length])
+      {
+        consume(length);
+        return table.symbols[code + table.valueOffset[length]];
+      }
+    }
+    return -1;
+  }
+
+  // Reads a magnitude category's extra bits and sign extends them
+  int receive(const int category)
+  {
+    if (category == 0)
+      return 0;
+    const auto value = static_cast<int>(peek(category));
+    consume(category);
+    return value < 1 << (category - 1) ? value - (1 << category) + 1 : value;
+  }
+
+  // Skips to the restart marker that ends the current interval. Returns false if it isn't one.
+  bool restart()
+  {
+    if (marker < 0)
+    {
+      while (position + 1 < size && !(data[position] == 0xFF && data[position + 1] != 0x00 && data[position + 1] != 0xFF))
+        position++;
+      marker = position + 1 < size ? data[position + 1] : -1;
+      markerPosition = position;
+    }
+    if (marker < 0xD0 || marker > 0xD7)
+      return false;
+    position = markerPosition + 2;
+    marker = -1;
+    buffer = 0;
+    bits = 0;
+    return true;
+  }
+};
+
+// T[i][u] = C(u) / 2 * cos((2i + 1) u pi / 2n). With it, an n-point IDCT of the low n coefficients
+// gives the n-sample average of the 8-point one: the 1/2 in both passes matches the 1/4 of the
+// full 8x8 transform, independently of n.
+struct _JpegIdctTable
+{
+  float weights[8][8];
+
+  explicit _JpegIdctTable(const int n)
+  {
+    for (int i = 0; i < n; i++)
+    {
+      for (int u = 0; u < n; u++)
+      {
+        const double c = u == 0 ? 1.0 / std::sqrt(2.0) : 1.0;
+        weights[i][u] = static_cast<float>(0.5 * c * std::cos((2 * i + 1) * u * 3.14159265358979323846 / (2.0 * n)));
+      }
+    }
+  }
+};
+
+inline const _JpegIdctTable& _jpegIdctTable(const int n)
+{
+  static const _JpegIdctTable tables[] = {_JpegIdctTable(1), _JpegIdctTable(2), _JpegIdctTable(4), _JpegIdctTable(8)};
+  return tables[n == 1 ? 0 : n == 2 ? 1 : n == 4 ? 2 : 3];
+}
+
+// N x N inverse DCT of the top-left coefficients (row major, stride 8) into an N x N block of
+// samples. Coefficient rows from `rows` on are all zero, which is most of them after quantisation.
+// Both passes accumulate whole output rows, so the compiler can vectorise them.
+template <int N>
+void _jpegIdct(const float* coefficients, int rows, uint8_t* output, const size_t stride)
+{
+  // Small blocks are faster fully unrolled than with a loop that skips rows
+  if constexpr (N <= 4)
+    rows = N;
+  const _JpegIdctTable& table = _jpegIdctTable(N);
+  float transformed[N][N] = {};
+  for (int v = 0; v < rows; v++)
+  {
+    for (int u = 0; u < N; u++)
+    {
+      const float coefficient = coefficients[v * 8 + u];
+      for (int x = 0; x < N; x++)
+      {
+        transformed[v][x] += table.weights[x][u] * coefficient;
+      }
+    }
+  }
+  for (int y = 0; y < N; y++)
+  {
+    float samples[N];
+    std::fill_n(samples, N, 128.5f); // Level shift and rounding
+    for (int v = 0; v < rows; v++)
+    {
+      for (int x = 0; x < N; x++)
+      {
+        samples[x] += table.weights[y][v] * transformed[v][x];
+      }
+    }
+    for (int x = 0; x < N; x++)
+    {
+      output[y * stride + x] = static_cast<uint8_t>(std::clamp(static_cast<int>(samples[x]), 0, 255));
+    }
+  }
+}
+
+inline void _jpegIdct(const float* coefficients, const int n, const int rows, uint8_t* output, const size_t stride)
+{
+  switch (n)
+  {
+    case 1: output[0] = static_cast<uint8_t>(std::clamp(static_cast<int>(coefficients[0] / 8.0f + 128.5f), 0, 255)); break;
+    case 2: _jpegIdct<2>(coefficients, rows, output, stride); break;
+    case 4: _jpegIdct<4>(coefficients, rows, output, stride); break;
+    default: _jpegIdct<8>(coefficients, rows, output, stride); break;
+  }
+}
+
+struct _JpegComponent
+{
+  int id, h, v, quant;
+  int dcTable = 0, acTable = 0;
+  int dcPredictor = 0;
+  int planeWidth = 0, planeHeight = 0; // Samples at the output scale, padded to whole MCUs
+  std::vector<uint8_t> plane;
+};
+
+// Coefficient rows the scaled IDCT has to look at for a nonzero coefficient at `position`. The
+// coefficients outside the top-left n x n are stored anyway and never read: that's cheaper than
+// a branch the predictor can't learn.
+inline int _jpegUsedRows(const int position, const int n)
+{
+  const bool used = (position & 7) < n && (position >> 3) < n;
+  return used ? (position >> 3) + 1 : 0;
+}
+
+// Decodes one block at the scaled size n into its place in the component's plane
+inline bool _decodeJpegBlock(_JpegBitReader& reader, const _JpegHuffman& dc, const _JpegHuffman& ac,
+                             const uint16_t* quant, _JpegComponent& component, const int n, const int blockX,
+                             const int blockY)
+{
+  float coefficients[64];
+  for (int v = 0; v < n; v++)
+  {
+    std::fill_n(coefficients + v * 8, n, 0.0f);
+  }
+
+  const int category = reader.decode(dc);
+  if (category < 0 || category > 15)
+    return false;
+  component.dcPredictor += reader.receive(category);
+  coefficients[0] = static_cast<float>(component.dcPredictor * quant[0]);
+
+  int rows = 1; // Rows of coefficients that aren't all zero
+  for (int k = 1; k < 64;)
+  {
+    if (reader.bits < 16)
+      reader.fill();
+    const int fast = ac.fastAc[reader.buffer >> (64 - JPEG_FAST_BITS)];
+    if (fast != 0)
+    {
+      reader.consume(fast & 15);
+      k += fast >> 4 & 15;
+      const int position = JPEG_ZIGZAG[k & 63];
+      coefficients[position] = static_cast<float>((fast >> 8) * quant[k & 63]);
+      rows = std::max(rows, _jpegUsedRows(position, n));
+      k++;
+      continue;
+    }
+
+    const int symbol = reader.decode(ac);
+    if (symbol < 0)
+      return false;
+    const int run = symbol >> 4, size = symbol & 15;
+    if (size == 0)
+    {
+      if (run != 15)
+        break; // End of block
+      k += 16;
+      continue;
+    }
+    k += run;
+    if (k > 63)
+      return false;
+
+    const int position = JPEG_ZIGZAG[k];
+    coefficients[position] = static_cast<float>(reader.receive(size) * quant[k]);
+    rows = std::max(rows, _jpegUsedRows(position, n));
+    k++;
+  }
+
+  _jpegIdct(coefficients, n, rows, &component.plane[static_cast<size_t>(blockY) * n * component.planeWidth + blockX * n],
+            component.planeWidth);
+  return true;
+}
+
+// Decodes a JPEG file in memory at 1/scale of its size, scale being 1, 2, 4 or 8. The image is
+// ceil(width / scale) x ceil(height / scale). Returns false for corrupt or unsupported files.
+inline bool decodeJpeg(const unsigned char* data, const size_t size, const int scale, JpegImage* image)
+{
+  if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+    return false;
+  const int n = 8 / scale;
+  if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+    return false;
+
+  uint16_t quantTables[4][64] = {};
+  _JpegHuffman dcTables[4], acTables[4];
+  std::vector<_JpegComponent> components;
+  int width = 0, height = 0, maxH = 1, maxV = 1, mcusX = 0, mcusY = 0;
+  int restartInterval = 0, adobeTransform = -1;
+  bool decodedScan = false;
+
+  size_t position = 2;
+  while (position + 4 <= size)
+  {
+    // Anything between segments, e.g. fill bytes, is skipped
+    if (data[position] != 0xFF || data[position + 1] == 0xFF || data[position + 1] == 0x00)
+    {
+      position++;
+      continue;
+    }
+    const int marker = data[position + 1];
+    position += 2;
+    if (marker == 0xD9)
+      break;
+    if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01)
+      continue;
+
+    const size_t length = data[position] << 8 | data[position + 1];
+    if (length < 2 || position + length > size)
+      return false;
+    const uint8_t* segment = data + position + 2;
+    const size_t segmentLength = length - 2;
+
+    if (marker == 0xDB)
+    {
+      for (size_t offset = 0; offset < segmentLength;)
+      {
+        const int precision = segment[offset] >> 4, id = segment[offset] & 3;
+        offset++;
+        if (offset + 64 * (precision + 1) > segmentLength)
+          return false;
+        for (int k = 0; k < 64; k++)
+        {
+          quantTables[id][k] = precision ? segment[offset + 2 * k] << 8 | segment[offset + 2 * k + 1] : segment[offset + k];
+        }
+        offset += 64 * (precision + 1);
+      }
+    }
+    else if (marker == 0xC4)
+    {
+      for (size_t offset = 0; offset + 17 <= segmentLength;)
+      {
+        const int tableClass = segment[offset] >> 4, id = segment[offset] & 3;
+        const uint8_t* counts = segment + offset + 1;
+        int valueCount = 0;
+        for (int i = 0; i < 16; i++)
+        {
+          valueCount += counts[i];
+        }
+        if (valueCount > 256 || offset + 17 + valueCount > segmentLength)
+          return false;
+        if (!(tableClass ? acTables : dcTables)[id].build(counts, segment + offset + 17, valueCount))
+          return false;
+        offset += 17 + valueCount;
+      }
+    }
+    else if (marker == 0xC0 || marker == 0xC1)
+    {
+      if (segmentLength < 6 || segment[0] != 8)
+        return false;
+      height = segment[1] << 8 | segment[2];
+      width = segment[3] << 8 | segment[4];
+      const int componentCount = segment[5];
+      if (width == 0 || height == 0 || (componentCount != 1 && componentCount != 3) ||
+          segmentLength < 6 + 3 * static_cast<size_t>(componentCount))
+        return false;
+      for (int c = 0; c < componentCount; c++)
+      {
+        const uint8_t* info = segment + 6 + 3 * c;
+        components.push_back({.id = info[0], .h = std::max(1, info[1] >> 4), .v = std::max(1, info[1] & 15),
+                              .quant = info[2] & 3, .plane = {}});
+        maxH = std::max(maxH, components.back().h);
+        maxV = std::max(maxV, components.back().v);
+      }
+      // A single component is always one block per MCU, whatever its sampling factors say
+      if (componentCount == 1)
+        components[0].h = components[0].v = maxH = maxV = 1;
+      mcusX = (width + 8 * maxH - 1) / (8 * maxH);
+      mcusY = (height + 8 * maxV - 1) / (8 * maxV);
+      for (_JpegComponent& component : components)
+      {
+        component.planeWidth = mcusX * component.h * n;
+        component.planeHeight = mcusY * component.v * n;
+        component.plane.resize(static_cast<size_t>(component.planeWidth) * component.planeHeight);
+      }
+    }
+    else if ((marker >= 0xC2 && marker <= 0xCF) && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+    {
+      return false; // Progressive, lossless or arithmetic coded
+    }
+    else if (marker == 0xDD && segmentLength >= 2)
+    {
+      restartInterval = segment[0] << 8 | segment[1];
+    }
+    else if (marker == 0xEE && segmentLength >= 12 && std::memcmp(segment, "Adobe", 5) == 0)
+    {
+      adobeTransform = segment[11];
+    }
+    else if (marker == 0xDA)
+    {
+      if (components.empty() || segmentLength < 1)
+        return false;
+      const int scanCount = segment[0];
+      if (scanCount < 1 || scanCount > static_cast<int>(components.size()) || segmentLength < 4 + 2 * static_cast<size_t>(scanCount))
+        return false;
+      std::vector<_JpegComponent*> scan;
+      for (int s = 0; s < scanCount; s++)
+      {
+        const auto it = std::find_if(components.begin(), components.end(),
+                                     [&](const _JpegComponent& c) { return c.id == segment[1 + 2 * s]; });
+        if (it == components.end())
+          return false;
+        it->dcTable = segment[2 + 2 * s] >> 4 & 3;
+        it->acTable = segment[2 + 2 * s] & 3;
+        if (!dcTables[it->dcTable].defined || !acTables[it->acTable].defined)
+          return false;
+        it->dcPredictor = 0;
+        scan.push_back(&*it);
+      }
+
+      _JpegBitReader reader{data, size, position + length};
+      // A scan of one component goes block by block in its own raster order, without MCUs
+      const bool interleaved = scanCount > 1;
+      const int unitsX = interleaved ? mcusX : ((width * scan[0]->h + maxH - 1) / maxH + 7) / 8;
+      const int unitsY = interleaved ? mcusY : ((height * scan[0]->v + maxV - 1) / maxV + 7) / 8;
+      int unitsLeft = restartInterval;
+      for (int unitY = 0; unitY < unitsY; unitY++)
+      {
+        for (int unitX = 0; unitX < unitsX; unitX++)
+        {
+          if (restartInterval > 0 && unitsLeft-- == 0)
+          {
+            if (!reader.restart())
+              return false;
+            for (_JpegComponent* component : scan)
+            {
+              component->dcPredictor = 0;
+            }
+            unitsLeft = restartInterval - 1;
+          }
+
+          for (_JpegComponent* component : scan)
+          {
+            const _JpegHuffman& dc = dcTables[component->dcTable];
+            const _JpegHuffman& ac = acTables[component->acTable];
+            const uint16_t* quant = quantTables[component->quant];
+            const int blocksH = interleaved ? component->h : 1, blocksV = interleaved ? component->v : 1;
+            for (int v = 0; v < blocksV; v++)
+            {
+              for (int h = 0; h < blocksH; h++)
+              {
+                if (!_decodeJpegBlock(reader, dc, ac, quant, *component, n, unitX * blocksH + h, unitY * blocksV + v))
+                  return false;
+              }
+            }
+          }
+        }
+      }
+
+      decodedScan = true;
+      position = reader.marker >= 0 ? reader.markerPosition : reader.position;
+      continue;
+    }
+
+    position += length;
+  }
+  if (!decodedScan)
+    return false;
+
+  image->width = (width * n + 7) / 8;
+  image->height = (height * n + 7) / 8;
+  image->channels = static_cast<int>(components.size());
+  image->pixels.resize(static_cast<size_t>(image->width) * image->height * image->channels);
+
+  if (components.size() == 1)
+  {
+    for (int y = 0; y < image->height; y++)
+    {
+      std::memcpy(&image->pixels[static_cast<size_t>(y) * image->width], &components[0].plane[static_cast<size_t>(y) * components[0].planeWidth],
+                  image->width);
+    }
+    return true;
+  }
+
+  // Adobe files say whether the components are YCbCr, anything else with three components is
+  const bool ycbcr = adobeTransform != 0;
+  for (int y = 0; y < image->height; y++)
+  {
+    const uint8_t* rows[3];
+    for (int c = 0; c < 3; c++)
+    {
+      rows[c] = &components[c].plane[static_cast<size_t>(y * components[c].v / maxV) * components[c].planeWidth];
+    }
+    unsigned char* out = &image->pixels[static_cast<size_t>(y) * image->width * 3];
+    for (int x = 0; x < image->width; x++)
+    {
+      const int luma = rows[0][x * components[0].h / maxH];
+      const int cb = rows[1][x * components[1].h / maxH];
+      const int cr = rows[2][x * components[2].h / maxH];
+      if (!ycbcr)
+      {
+        out[x * 3] = luma;
+        out[x * 3 + 1] = cb;
+        out[x * 3 + 2] = cr;
+        continue;
+      }
+      // JFIF conversion in 16.16 fixed point
+      const int yScaled = luma << 16 | 1 << 15;
+      out[x * 3] = std::clamp((yScaled + 91881 * (cr - 128)) >> 16, 0, 255);
+      out[x * 3 + 1] = std::clamp((yScaled - 22554 * (cb - 128) - 46802 * (cr - 128)) >> 16, 0, 255);
+      out[x * 3 + 2] = std::clamp((yScaled + 116130 * (cb - 128)) >> 16, 0, 255);
+    }
+  }
+  return true;
+}
+
+inline bool loadJpeg(const char* path, const int scale, JpegImage* image)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  const std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  return decodeJpeg(data.data(), data.size(), scale, image);
+}
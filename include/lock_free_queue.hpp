@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's algorithm). Every cell carries
+// a sequence number that tells producers and consumers whose turn it is, so neither side ever
+// takes a lock or waits on the other; a full or empty queue is reported instead.
+template <typename T>
+class LockFreeQueue
+{
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // Keeps the producer and consumer counters on separate cache lines
+  static constexpr size_t CACHE_LINE_SIZE = 64;
+
+  std::unique_ptr<Cell[]> _cells;
+  size_t _mask;
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> _pushPosition{0};
+  alignas(CACHE_LINE_SIZE) std::atomic<size_t> _popPosition{0};
+
+  // The value is only copied or moved into the queue once a cell has been claimed
+  template <typename U>
+  bool _tryPush(U&& value)
+  {
+    size_t position = _pushPosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true)
+    {
+      cell = &_cells[position & _mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+      if (difference == 0)
+      {
+        if (_pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (difference < 0)
+      {
+        return false; // Full
+      }
+      else
+      {
+        position = _pushPosition.load(std::memory_order_relaxed);
+      }
+    }
+
+    cell->value = std::forward<U>(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+public:
+  // capacity is rounded up to a power of two
+  explicit LockFreeQueue(const size_t capacity)
+  {
+    size_t size = 2;
+    while (size < capacity)
+    {
+      size *= 2;
+    }
+
+    _cells = std::make_unique<Cell[]>(size);
+    _mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+    {
+      _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LockFreeQueue(const LockFreeQueue&) = delete;
+  LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+  bool tryPush(const T& value) { return _tryPush(value); }
+
+  // Leaves value untouched if the queue is full, so a retry doesn't need a copy of it
+  bool tryPush(T&& value) { return _tryPush(std::move(value)); }
+
+  bool tryPop(T& value)
+  {
+    size_t position = _popPosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true)
+    {
+      cell = &_cells[position & _mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+      if (difference == 0)
+      {
+        if (_popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (difference < 0)
+      {
+        return false; // Empty
+      }
+      else
+      {
+        position = _popPosition.load(std::memory_order_relaxed);
+      }
+    }
+
+    value = std::move(cell->value);
+    cell->sequence.store(position + _mask + 1, std::memory_order_release);
+    return true;
+  }
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+#include "vertex_layout.hpp"
+
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/constants.hpp"
+
+typedef unsigned int uint;
+
+// A mesh with full precision attributes, kept as separate streams. This is the input format
+// of the mesh processing stages (quantization, welding, optimization) before upload.
+struct FloatMesh
+{
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> normals;
+  std::vector<uint> indices;
+};
+
+// Interleaved full precision vertex, 32 bytes
+struct MeshVertex
+{
+  glm::vec3 position;
+  glm::vec2 uv;
+  glm::vec3 normal;
+};
+
+using MeshLayout = VertexLayout<Attr<Position, Float3>, Attr<UV, Float2>, Attr<Normal, Float3>>;
+static_assert(MeshLayout::matches<MeshVertex, &MeshVertex::position, &MeshVertex::uv, &MeshVertex::normal>());
+
+inline std::vector<MeshVertex> interleave(const FloatMesh& mesh)
+{
+  std::vector<MeshVertex> vertices(mesh.positions.size());
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    vertices[i].position = mesh.positions[i];
+    vertices[i].uv = i < mesh.uvs.size() ? mesh.uvs[i] : glm::vec2(0.0f);
+    vertices[i].normal = i < mesh.normals.size() ? mesh.normals[i] : glm::vec3(0.0f);
+  }
+  return vertices;
+}
+
+// UV sphere of radius 1 with (segments + 1) * (rings + 1) vertices and 2 * segments * rings triangles
+inline FloatMesh generateSphere(const uint segments, const uint rings)
+{
+  FloatMesh mesh;
+  const size_t vertexCount = static_cast<size_t>(segments + 1) * (rings + 1);
+  mesh.positions.reserve(vertexCount);
+  mesh.uvs.reserve(vertexCount);
+  mesh.normals.reserve(vertexCount);
+
+  for (uint ring = 0; ring <= rings; ring++)
+  {
+    const float v = static_cast<float>(ring) / static_cast<float>(rings);
+    const float phi = v * glm::pi<float>();
+    for (uint segment = 0; segment <= segments; segment++)
+    {
+      const float u = static_cast<float>(segment) / static_cast<float>(segments);
+      const float theta = u * glm::two_pi<float>();
+      const glm::vec3 normal(glm::cos(theta) * glm::sin(phi), glm::cos(phi), glm::sin(theta) * glm::sin(phi));
+
+      mesh.positions.push_back(normal);
+      mesh.uvs.emplace_back(u, 1.0f - v);
+      mesh.normals.push_back(normal);
+    }
+  }
+
+  mesh.indices.reserve(static_cast<size_t>(segments) * rings * 6);
+  for (uint ring = 0; ring < rings; ring++)
+  {
+    for (uint segment = 0; segment < segments; segment++)
+    {
+      const uint topLeft = ring * (segments + 1) + segment;
+      const uint bottomLeft = topLeft + segments + 1;
+      mesh.indices.insert(mesh.indices.end(), {topLeft, topLeft + 1, bottomLeft});
+      mesh.indices.insert(mesh.indices.end(), {topLeft + 1, bottomLeft + 1, bottomLeft});
+    }
+  }
+
+  return mesh;
+}
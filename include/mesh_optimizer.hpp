@@ -0,0 +1,482 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+#include "mesh.hpp"
+
+#include "ext/glm/glm.hpp"
+
+// Post-transform cache efficiency of an index buffer
+struct VertexCacheStats
+{
+  float acmr; // Average cache miss ratio: transformed vertices per triangle, 0.5 at best, 3 at worst
+  float atvr; // Average transformed vertex ratio: transformed vertices per vertex, 1 at best
+};
+
+// Emulates a FIFO post-transform cache of `cacheSize` entries, which is what most GPUs
+// behave like closely enough for comparing triangle orders.
+inline VertexCacheStats analyzeVertexCache(const std::vector<uint>& indices, const uint vertexCount,
+                                           const uint cacheSize = 16)
+{
+  // A vertex is in the cache while fewer than cacheSize misses happened since it was loaded
+  std::vector<uint> loadedAt(vertexCount, 0);
+  uint misses = 0;
+  uint time = cacheSize + 1;
+
+  for (const uint index : indices)
+  {
+    if (time - loadedAt[index] > cacheSize)
+    {
+      loadedAt[index] = time++;
+      misses++;
+    }
+  }
+
+  const size_t triangleCount = indices.size() / 3;
+  return {
+    triangleCount > 0 ? static_cast<float>(misses) / static_cast<float>(triangleCount) : 0.0f,
+    vertexCount > 0 ? static_cast<float>(misses) / static_cast<float>(vertexCount) : 0.0f,
+  };
+}
+
+// Reorders triangles for the post-transform cache using Tom Forsyth's linear-speed vertex cache
+// optimisation: repeatedly emit the triangle whose vertices are most recently used and have the
+// fewest triangles left, so vertices get finished off while they are still cached.
+inline std::vector<uint> optimizeVertexCache(const std::vector<uint>& indices, const uint vertexCount)
+{
+  constexpr int CACHE_SIZE = 32;
+  constexpr float CACHE_DECAY_POWER = 1.5f;
+  constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+  constexpr float VALENCE_BOOST_SCALE = 2.0f;
+  constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+  const size_t triangleCount = indices.size() / 3;
+  std::vector<uint> result;
+  result.reserve(triangleCount * 3);
+
+  // Triangles using each vertex, as ranges into one flat array
+  std::vector<uint> remaining(vertexCount, 0);
+  for (const uint index : indices)
+  {
+    remaining[index]++;
+  }
+  std::vector<uint> adjacencyOffsets(vertexCount + 1, 0);
+  std::partial_sum(remaining.begin(), remaining.end(), adjacencyOffsets.begin() + 1);
+  std::vector<uint> adjacency(indices.size());
+  {
+    std::vector<uint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+      adjacency[fill[indices[i]]++] = i / 3;
+    }
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  const auto vertexScore = [&](const uint vertex) {
+    if (remaining[vertex] == 0)
+    {
+      return -1.0f;
+    }
+
+    float score = 0.0f;
+    const int position = cachePosition[vertex];
+    if (position >= 0)
+    {
+      // The vertices of the last triangle get a fixed score, so its neighbours aren't favoured
+      // over each other based on the order the triangle's indices happen to be in
+      score = position < 3 ? LAST_TRIANGLE_SCORE
+                           : std::pow(1.0f - static_cast<float>(position - 3) / (CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+    return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining[vertex]), -VALENCE_BOOST_POWER);
+  };
+
+  std::vector<float> vertexScores(vertexCount);
+  for (uint v = 0; v < vertexCount; v++)
+  {
+    vertexScores[v] = vertexScore(v);
+  }
+
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+  }
+
+  std::vector<uint> cache, newCache;
+  cache.reserve(CACHE_SIZE + 3);
+  newCache.reserve(CACHE_SIZE + 3);
+
+  size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+  size_t deadEndCursor = 0;
+
+  for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+  {
+    if (bestTriangle >= triangleCount)
+    {
+      // Nothing in the cache has triangles left, continue with the next triangle in input order
+      while (emitted[deadEndCursor])
+      {
+        deadEndCursor++;
+      }
+      bestTriangle = deadEndCursor;
+    }
+
+    const uint* triangle = &indices[bestTriangle * 3];
+    result.insert(result.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = true;
+
+    for (int i = 0; i < 3; i++)
+    {
+      const uint vertex = triangle[i];
+      uint* begin = &adjacency[adjacencyOffsets[vertex]];
+      uint* end = begin + remaining[vertex];
+      *std::find(begin, end, bestTriangle) = *(end - 1);
+      remaining[vertex]--;
+    }
+
+    // The triangle's vertices move to the front of the cache, everything else shifts back
+    newCache.assign(triangle, triangle + 3);
+    for (const uint vertex : cache)
+    {
+      if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+      {
+        newCache.push_back(vertex);
+      }
+    }
+    for (size_t i = 0; i < newCache.size(); i++)
+    {
+      cachePosition[newCache[i]] = i < CACHE_SIZE ? static_cast<int>(i) : -1;
+    }
+    if (newCache.size() > CACHE_SIZE)
+    {
+      newCache.resize(CACHE_SIZE);
+    }
+
+    // Rescore the vertices whose cache position changed, including the evicted ones, and their triangles
+    for (const uint vertex : cache)
+    {
+      vertexScores[vertex] = vertexScore(vertex);
+    }
+    for (int i = 0; i < 3; i++)
+    {
+      vertexScores[triangle[i]] = vertexScore(triangle[i]);
+    }
+
+    bestTriangle = triangleCount;
+    float bestScore = -1.0f;
+    for (const uint vertex : newCache)
+    {
+      const uint* begin = &adjacency[adjacencyOffsets[vertex]];
+      for (const uint* t = begin; t != begin + remaining[vertex]; t++)
+      {
+        const uint* tri = &indices[*t * 3];
+        triangleScores[*t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+        if (triangleScores[*t] > bestScore)
+        {
+          bestScore = triangleScores[*t];
+          bestTriangle = *t;
+        }
+      }
+    }
+
+    std::swap(cache, newCache);
+  }
+
+  return result;
+}
+
+// Reorders the clusters of a cache optimised index buffer so that triangles facing outwards,
+// which are likely to occlude the rest of the mesh, are drawn first (the sorting step of
+// Tipsify, Sander et al. 2007). Hard cluster boundaries are where the emulated cache starts
+// cold, i.e. at triangles whose three vertices all miss. Each hard cluster is then cut into
+// smaller ones as soon as the ACMR since the last cut, with the cache flushed there, is within
+// `threshold` of the whole cluster's, so the reordering costs at most that much cache efficiency.
+inline std::vector<uint> optimizeOverdraw(const std::vector<uint>& indices, const std::vector<glm::vec3>& positions,
+                                          const float threshold = 1.05f, const uint cacheSize = 16)
+{
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+  {
+    return indices;
+  }
+
+  std::vector<uint> loadedAt(positions.size(), 0);
+  uint time = cacheSize + 1;
+  const auto flushCache = [&] { time += cacheSize + 1; };
+  const auto triangleMisses = [&](const size_t t) {
+    int misses = 0;
+    for (int i = 0; i < 3; i++)
+    {
+      const uint index = indices[t * 3 + i];
+      if (time - loadedAt[index] > cacheSize)
+      {
+        loadedAt[index] = time++;
+        misses++;
+      }
+    }
+    return misses;
+  };
+
+  std::vector<size_t> hardStarts;
+  for (size_t t = 0; t < triangleCount; t++)
+  {
+    if (triangleMisses(t) == 3 || t == 0)
+    {
+      hardStarts.push_back(t);
+    }
+  }
+  hardStarts.push_back(triangleCount);
+
+  std::vector<size_t> clusterStarts;
+  for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+  {
+    const size_t begin = hardStarts[h], end = hardStarts[h + 1];
+    flushCache();
+    size_t clusterMisses = 0;
+    for (size_t t = begin; t < end; t++)
+    {
+      clusterMisses += triangleMisses(t);
+    }
+    const float thresholdAcmr = static_cast<float>(clusterMisses) / static_cast<float>(end - begin) * threshold;
+
+    flushCache();
+    clusterStarts.push_back(begin);
+    size_t misses = 0, triangles = 0;
+    for (size_t t = begin; t < end; t++)
+    {
+      misses += triangleMisses(t);
+      triangles++;
+      if (t + 1 < end && static_cast<float>(misses) <= thresholdAcmr * static_cast<float>(triangles))
+      {
+        clusterStarts.push_back(t + 1);
+        misses = triangles = 0;
+        flushCache();
+      }
+    }
+  }
+  clusterStarts.push_back(triangleCount);
+
+  // Area weighted centroid and normal of every cluster, and of the whole mesh
+  const size_t clusterCount = clusterStarts.size() - 1;
+  std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+  std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+  glm::vec3 meshCentroid(0.0f);
+  float meshArea = 0.0f;
+
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    float clusterArea = 0.0f;
+    for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+    {
+      const glm::vec3& a = positions[indices[t * 3]];
+      const glm::vec3& b = positions[indices[t * 3 + 1]];
+      const glm::vec3& c2 = positions[indices[t * 3 + 2]];
+      const glm::vec3 normal = glm::cross(b - a, c2 - a);
+      const float area = glm::length(normal);
+
+      clusterNormals[c] += normal;
+      clusterCentroids[c] += (a + b + c2) * (area / 3.0f);
+      clusterArea += area;
+    }
+
+    meshCentroid += clusterCentroids[c];
+    meshArea += clusterArea;
+    if (clusterArea > 0.0f)
+    {
+      clusterCentroids[c] /= clusterArea;
+    }
+  }
+  if (meshArea > 0.0f)
+  {
+    meshCentroid /= meshArea;
+  }
+
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t c = 0; c < clusterCount; c++)
+  {
+    const float length = glm::length(clusterNormals[c]);
+    const glm::vec3 normal = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+    sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+  }
+
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+  std::vector<uint> result;
+  result.reserve(indices.size());
+  for (const size_t c : order)
+  {
+    result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+  }
+  return result;
+}
+
+// Rewrites the indices to number vertices in the order they are first used and returns the
+// new index of every old vertex, ~0u for vertices that are never used.
+inline std::vector<uint> buildVertexFetchRemap(std::vector<uint>& indices, const size_t vertexCount, uint& usedCount)
+{
+  constexpr uint UNUSED = ~0u;
+  std::vector<uint> remap(vertexCount, UNUSED);
+  usedCount = 0;
+
+  for (uint& index : indices)
+  {
+    if (remap[index] == UNUSED)
+    {
+      remap[index] = usedCount++;
+    }
+    index = remap[index];
+  }
+  return remap;
+}
+
+template <typename T>
+void applyVertexRemap(std::vector<T>& stream, const std::vector<uint>& remap, const uint usedCount)
+{
+  if (stream.empty())
+  {
+    return;
+  }
+
+  std::vector<T> reordered(usedCount);
+  for (size_t i = 0; i < remap.size(); i++)
+  {
+    if (remap[i] != ~0u)
+    {
+      reordered[remap[i]] = stream[i];
+    }
+  }
+  stream = std::move(reordered);
+}
+
+// Reorders vertices into the order the index buffer first uses them, so the vertex fetch
+// walks memory mostly linearly. Unreferenced vertices are dropped and the indices rewritten.
+template <typename Vertex>
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint>& indices)
+{
+  uint usedCount;
+  const std::vector<uint> remap = buildVertexFetchRemap(indices, vertices.size(), usedCount);
+  applyVertexRemap(vertices, remap, usedCount);
+}
+
+// Runs all three stages in order on a mesh whose vertices have a glm::vec3 `position`
+template <typename Vertex>
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint>& indices)
+{
+  indices = optimizeVertexCache(indices, vertices.size());
+
+  std::vector<glm::vec3> positions(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    positions[i] = vertices[i].position;
+  }
+  indices = optimizeOverdraw(indices, positions);
+
+  optimizeVertexFetch(vertices, indices);
+}
+
+// Same as above for a mesh kept as separate attribute streams
+inline void optimizeMesh(FloatMesh& mesh)
+{
+  mesh.indices = optimizeVertexCache(mesh.indices, mesh.positions.size());
+  mesh.indices = optimizeOverdraw(mesh.indices, mesh.positions);
+
+  uint usedCount;
+  const std::vector<uint> remap = buildVertexFetchRemap(mesh.indices, mesh.positions.size(), usedCount);
+  applyVertexRemap(mesh.positions, remap, usedCount);
+  applyVertexRemap(mesh.uvs, remap, usedCount);
+  applyVertexRemap(mesh.normals, remap, usedCount);
+}
+
+// Rasterises the mesh with back-face culling and a depth test into orthographic views along the
+// six axis directions and returns the average number of fragments shaded per covered pixel.
+// Only meant for comparing triangle orders of the same mesh on the CPU.
+inline float analyzeOverdraw(const std::vector<uint>& indices, const std::vector<glm::vec3>& positions,
+                             const int resolution = 256)
+{
+  if (positions.empty())
+  {
+    return 0.0f;
+  }
+
+  glm::vec3 minCorner = positions[0], maxCorner = positions[0];
+  for (const glm::vec3& p : positions)
+  {
+    minCorner = glm::min(minCorner, p);
+    maxCorner = glm::max(maxCorner, p);
+  }
+  const glm::vec3 extent = glm::max(maxCorner - minCorner, glm::vec3(1e-6f));
+
+  std::vector<float> depth(static_cast<size_t>(resolution) * resolution);
+  size_t shaded = 0, covered = 0;
+
+  for (int axis = 0; axis < 3; axis++)
+  {
+    for (const float direction : {1.0f, -1.0f})
+    {
+      std::fill(depth.begin(), depth.end(), 2.0f);
+
+      // Screen x/y are the other two axes, depth runs along the view axis
+      const int xAxis = (axis + 1) % 3, yAxis = (axis + 2) % 3;
+      const auto project = [&](const glm::vec3& p) {
+        const glm::vec3 n = (p - minCorner) / extent;
+        return glm::vec3(n[xAxis] * resolution, n[yAxis] * resolution, direction > 0 ? n[axis] : 1.0f - n[axis]);
+      };
+
+      for (size_t t = 0; t + 2 < indices.size(); t += 3)
+      {
+        const glm::vec3 a = project(positions[indices[t]]);
+        glm::vec3 b = project(positions[indices[t + 1]]);
+        glm::vec3 c = project(positions[indices[t + 2]]);
+
+        float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        // Looking down +axis front faces wind clockwise on screen, looking down -axis they don't
+        if (direction > 0)
+        {
+          std::swap(b, c);
+          area = -area;
+        }
+        if (area <= 0.0f)
+        {
+          continue;
+        }
+
+        const int minX = std::max(0, static_cast<int>(std::floor(std::min({a.x, b.x, c.x}))));
+        const int maxX = std::min(resolution - 1, static_cast<int>(std::ceil(std::max({a.x, b.x, c.x}))));
+        const int minY = std::max(0, static_cast<int>(std::floor(std::min({a.y, b.y, c.y}))));
+        const int maxY = std::min(resolution - 1, static_cast<int>(std::ceil(std::max({a.y, b.y, c.y}))));
+
+        for (int y = minY; y <= maxY; y++)
+        {
+          for (int x = minX; x <= maxX; x++)
+          {
+            const float px = static_cast<float>(x) + 0.5f, py = static_cast<float>(y) + 0.5f;
+            const float w0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+            const float w1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+            const float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+            if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+            {
+              continue;
+            }
+
+            const float z = (w0 * a.z + w1 * b.z + w2 * c.z) / area;
+            float& stored = depth[static_cast<size_t>(y) * resolution + x];
+            if (z < stored)
+            {
+              covered += stored > 1.5f ? 1 : 0;
+              stored = z;
+              shaded++;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  return covered > 0 ? static_cast<float>(shaded) / static_cast<float>(covered) : 0.0f;
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "mesh.hpp"
+#include "vertex_layout.hpp"
+
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/matrix_transform.hpp"
+
+// 16 bytes per vertex, against 32 for float positions, UVs and normals
+struct QuantizedVertex
+{
+  Snorm16x4::Storage position;      // Relative to the mesh bounding box, w is unused
+  Half2::Storage uv;
+  Snorm10_10_10_2::Storage normal;
+};
+
+using QuantizedLayout = VertexLayout<Attr<Position, Snorm16x4>, Attr<UV, Half2>, Attr<Normal, Snorm10_10_10_2>>;
+static_assert(QuantizedLayout::matches<QuantizedVertex, &QuantizedVertex::position, &QuantizedVertex::uv,
+                                       &QuantizedVertex::normal>());
+
+// Largest difference between a source attribute and what the vertex fetch decodes it to
+struct QuantizationError
+{
+  float position;      // Object space units, per component
+  float uv;            // Per component
+  float normalDegrees; // Angle between the source and the decoded normal
+};
+
+struct QuantizedMesh
+{
+  std::vector<QuantizedVertex> vertices;
+  std::vector<uint> indices;
+  // Maps the decoded [-1, 1] positions back to object space. Fold it into the model matrix
+  // (model * dequantization) so the shaders don't need to know about quantization.
+  glm::mat4 dequantization;
+  QuantizationError error;
+  size_t sourceBytes, quantizedBytes;
+};
+
+inline glm::vec3 decodeSnorm10_10_10(const glm::uint32 packed)
+{
+  glm::vec3 result;
+  for (int i = 0; i < 3; i++)
+  {
+    // Sign extend each 10-bit field
+    int value = static_cast<int>((packed >> (10 * i)) & 0x3FF);
+    if (value & 0x200)
+      value -= 0x400;
+    result[i] = decodeSnorm(value, 10);
+  }
+  return result;
+}
+
+// Compresses positions to snorm16 within the mesh's bounding box, UVs to half floats and
+// normals to GL_INT_2_10_10_10_REV, and measures the error that introduces.
+inline QuantizedMesh quantizeMesh(const FloatMesh& mesh)
+{
+  QuantizedMesh result{};
+  const size_t vertexCount = mesh.positions.size();
+  result.vertices.resize(vertexCount);
+  result.indices = mesh.indices;
+
+  glm::vec3 minCorner(0.0f), maxCorner(0.0f);
+  if (vertexCount > 0)
+  {
+    minCorner = maxCorner = mesh.positions[0];
+  }
+  for (const glm::vec3& position : mesh.positions)
+  {
+    minCorner = glm::min(minCorner, position);
+    maxCorner = glm::max(maxCorner, position);
+  }
+
+  const glm::vec3 centre = (minCorner + maxCorner) * 0.5f;
+  glm::vec3 halfExtent = (maxCorner - minCorner) * 0.5f;
+  // A flat axis decodes to the centre no matter what it is scaled by
+  for (int axis = 0; axis < 3; axis++)
+  {
+    if (halfExtent[axis] <= 0.0f)
+      halfExtent[axis] = 1.0f;
+  }
+  result.dequantization = glm::scale(glm::translate(glm::mat4(1.0f), centre), halfExtent);
+
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    QuantizedVertex& vertex = result.vertices[i];
+
+    const glm::vec3 normalized = (mesh.positions[i] - centre) / halfExtent;
+    vertex.position = Snorm16x4::pack(glm::vec4(normalized, 0.0f));
+    glm::vec3 decodedPosition;
+    for (int axis = 0; axis < 3; axis++)
+    {
+      decodedPosition[axis] = decodeSnorm(vertex.position[axis], 16) * halfExtent[axis] + centre[axis];
+    }
+    const glm::vec3 positionError = glm::abs(decodedPosition - mesh.positions[i]);
+    result.error.position = std::max({result.error.position, positionError.x, positionError.y, positionError.z});
+
+    if (i < mesh.uvs.size())
+    {
+      vertex.uv = Half2::pack(mesh.uvs[i]);
+      const glm::vec2 decodedUV(glm::unpackHalf1x16(vertex.uv.x), glm::unpackHalf1x16(vertex.uv.y));
+      const glm::vec2 uvError = glm::abs(decodedUV - mesh.uvs[i]);
+      result.error.uv = std::max({result.error.uv, uvError.x, uvError.y});
+    }
+
+    if (i < mesh.normals.size())
+    {
+      const glm::vec3 normal = glm::normalize(mesh.normals[i]);
+      vertex.normal = Snorm10_10_10_2::pack(glm::vec4(normal, 0.0f));
+      const glm::vec3 decodedNormal = glm::normalize(decodeSnorm10_10_10(vertex.normal));
+      const float cosAngle = glm::clamp(glm::dot(normal, decodedNormal), -1.0f, 1.0f);
+      result.error.normalDegrees = std::max(result.error.normalDegrees, glm::degrees(glm::acos(cosAngle)));
+    }
+  }
+
+  result.sourceBytes = vertexCount * (sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::vec3));
+  result.quantizedBytes = vertexCount * sizeof(QuantizedVertex);
+  return result;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+typedef unsigned int uint;
+
+template <typename T>
+struct WeldedMesh
+{
+  std::vector<T> vertices;
+  std::vector<uint> indices;
+};
+
+// Finds bitwise identical vertices. remap[i] receives the index of vertex i in the unique
+// vertex list, which keeps the first occurrence of every vertex in its original order.
+// Returns the number of unique vertices.
+inline uint buildVertexRemap(const void* vertices, const size_t vertexCount, const size_t vertexSize,
+                             std::vector<uint>& remap)
+{
+  const auto bytes = static_cast<const unsigned char*>(vertices);
+  const auto vertexAt = [&](const uint i) { return bytes + i * vertexSize; };
+
+  // Open addressing table of unique vertex indices, kept at most half full
+  size_t tableSize = 16;
+  while (tableSize < vertexCount * 2)
+  {
+    tableSize *= 2;
+  }
+  constexpr uint EMPTY = ~0u;
+  std::vector<uint> table(tableSize, EMPTY);
+  std::vector<uint> uniqueToSource;
+  uniqueToSource.reserve(vertexCount);
+
+  remap.resize(vertexCount);
+  for (uint i = 0; i < vertexCount; i++)
+  {
+    // FNV-1a over the vertex bytes
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t b = 0; b < vertexSize; b++)
+    {
+      hash = (hash ^ vertexAt(i)[b]) * 1099511628211ull;
+    }
+
+    size_t slot = hash & (tableSize - 1);
+    while (table[slot] != EMPTY &&
+           std::memcmp(vertexAt(uniqueToSource[table[slot]]), vertexAt(i), vertexSize) != 0)
+    {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+
+    if (table[slot] == EMPTY)
+    {
+      table[slot] = uniqueToSource.size();
+      uniqueToSource.push_back(i);
+    }
+    remap[i] = table[slot];
+  }
+
+  return uniqueToSource.size();
+}
+
+// Turns a non-indexed vertex array into unique vertices plus an index buffer. Vertices are
+// compared bitwise, so positions that differ only in another attribute (e.g. the UVs at a
+// cube corner) stay separate.
+template <typename Vertex>
+WeldedMesh<Vertex> weldVertices(const std::vector<Vertex>& vertices)
+{
+  WeldedMesh<Vertex> mesh;
+  const uint uniqueCount = buildVertexRemap(vertices.data(), vertices.size(), sizeof(Vertex), mesh.indices);
+
+  mesh.vertices.resize(uniqueCount);
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    mesh.vertices[mesh.indices[i]] = vertices[i];
+  }
+  return mesh;
+}
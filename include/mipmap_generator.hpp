@@ -0,0 +1,412 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+typedef unsigned int uint;
+
+// One level of a mip chain with tightly packed rows
+struct MipLevel
+{
+  int width, height;
+  std::vector<unsigned char> pixels;
+};
+
+enum class MipFilter
+{
+  Box,    // 2x2 average, what glGenerateMipmap does on most drivers
+  Kaiser, // 8x8 windowed sinc, keeps more detail without aliasing
+};
+
+struct MipOptions
+{
+  MipFilter filter = MipFilter::Box;
+  // Treats the colour channels of 3 and 4 channel images as sRGB encoded: they are converted to
+  // linear before filtering and back afterwards, so mips don't darken. Alpha is always linear.
+  bool srgb = false;
+  // Output rows of each level are split into this many bands, one per thread
+  uint threadCount = 1;
+};
+
+constexpr int MIP_MAX_TAPS = 8;
+constexpr int MIP_ENCODE_TABLE_SIZE = 1 << 14;
+
+// Separable filter for a 2x reduction. Output pixel x reads source pixels 2x + offset + k.
+struct MipKernel
+{
+  int taps;
+  int offset;
+  float weights[MIP_MAX_TAPS];
+};
+
+inline const MipKernel& mipKernel(const MipFilter filter)
+{
+  static const MipKernel box{2, 0, {0.5f, 0.5f}};
+  static const MipKernel kaiser = [] {
+    // Zeroth order modified Bessel function of the first kind, for the Kaiser window
+    const auto bessel = [](const double x) {
+      double sum = 1.0, term = 1.0;
+      for (int k = 1; k < 20; k++)
+      {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+      }
+      return sum;
+    };
+    constexpr double PI = 3.14159265358979323846, ALPHA = 4.0, HALF_WIDTH = MIP_MAX_TAPS / 2;
+
+    MipKernel kernel{MIP_MAX_TAPS, -MIP_MAX_TAPS / 2 + 1, {}};
+    double total = 0.0, weights[MIP_MAX_TAPS];
+    for (int k = 0; k < MIP_MAX_TAPS; k++)
+    {
+      // Distance from the centre of the output pixel, which lies between source pixels 2x and 2x + 1
+      const double distance = kernel.offset + k - 0.5;
+      const double x = distance / 2.0;
+      const double sinc = std::sin(PI * x) / (PI * x);
+      const double ratio = distance / HALF_WIDTH;
+      weights[k] = sinc * bessel(ALPHA * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / bessel(ALPHA);
+      total += weights[k];
+    }
+    for (int k = 0; k < MIP_MAX_TAPS; k++)
+    {
+      kernel.weights[k] = static_cast<float>(weights[k] / total);
+    }
+    return kernel;
+  }();
+  return filter == MipFilter::Box ? box : kaiser;
+}
+
+// Conversions between 8-bit values and the linear floats the filters work on. Decoding is a
+// 256 entry table per curve, sRGB encoding indexes a finer table with the quantized linear value.
+struct MipTables
+{
+  float decodeLinear[256];
+  float decodeSrgb[256];
+  unsigned char encodeSrgb[MIP_ENCODE_TABLE_SIZE];
+};
+
+inline const MipTables& mipTables()
+{
+  static const MipTables tables = [] {
+    MipTables result{};
+    for (int i = 0; i < 256; i++)
+    {
+      const float value = i / 255.0f;
+      result.decodeLinear[i] = value;
+      result.decodeSrgb[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < MIP_ENCODE_TABLE_SIZE; i++)
+    {
+      const float value = static_cast<float>(i) / (MIP_ENCODE_TABLE_SIZE - 1);
+      const float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+      result.encodeSrgb[i] = static_cast<unsigned char>(srgb * 255.0f + 0.5f);
+    }
+    return result;
+  }();
+  return tables;
+}
+
+inline bool _isSrgbChannel(const MipOptions& options, const int channels, const int channel)
+{
+  return options.srgb && channels >= 3 && channel < 3;
+}
+
+inline unsigned char _encodeLinear(const float value)
+{
+  return static_cast<unsigned char>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+inline unsigned char _encodeSrgb(const float value)
+{
+  return mipTables().encodeSrgb[static_cast<int>(std::clamp(value, 0.0f, 1.0f) * (MIP_ENCODE_TABLE_SIZE - 1) + 0.5f)];
+}
+
+// Reference implementation, one output value at a time with the full 2D kernel
+inline MipLevel downsampleScalar(const unsigned char* pixels, const int width, const int height, const int channels,
+                                 const MipOptions& options = {})
+{
+  const MipKernel& kernel = mipKernel(options.filter);
+  const MipTables& tables = mipTables();
+  MipLevel result{std::max(1, width / 2), std::max(1, height / 2), {}};
+  result.pixels.resize(static_cast<size_t>(result.width) * result.height * channels);
+
+  for (int y = 0; y < result.height; y++)
+  {
+    for (int x = 0; x < result.width; x++)
+    {
+      for (int c = 0; c < channels; c++)
+      {
+        const bool srgb = _isSrgbChannel(options, channels, c);
+        const float* decode = srgb ? tables.decodeSrgb : tables.decodeLinear;
+        float sum = 0.0f;
+        for (int ky = 0; ky < kernel.taps; ky++)
+        {
+          const int sy = std::clamp(2 * y + kernel.offset + ky, 0, height - 1);
+          float row = 0.0f;
+          for (int kx = 0; kx < kernel.taps; kx++)
+          {
+            const int sx = std::clamp(2 * x + kernel.offset + kx, 0, width - 1);
+            row += kernel.weights[kx] * decode[pixels[(static_cast<size_t>(sy) * width + sx) * channels + c]];
+          }
+          sum += kernel.weights[ky] * row;
+        }
+        result.pixels[(static_cast<size_t>(y) * result.width + x) * channels + c] =
+          srgb ? _encodeSrgb(sum) : _encodeLinear(sum);
+      }
+    }
+  }
+  return result;
+}
+
+#if defined(__AVX__) || defined(__SSE2__)
+#if defined(__AVX__)
+// The vertical pass and the encoding run over whole rows, 8 floats at a time
+constexpr size_t MIP_LANES = 8;
+typedef __m256 MipVector;
+
+inline MipVector mipLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline void mipStore(float* p, const MipVector v) { _mm256_storeu_ps(p, v); }
+inline MipVector mipSet(const float v) { return _mm256_set1_ps(v); }
+inline MipVector mipAdd(const MipVector a, const MipVector b) { return _mm256_add_ps(a, b); }
+inline MipVector mipMul(const MipVector a, const MipVector b) { return _mm256_mul_ps(a, b); }
+inline MipVector mipClamp(const MipVector v) { return _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f)); }
+inline void mipStoreInts(int* p, const MipVector v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm256_cvttps_epi32(v)); }
+
+inline void mipStoreBytes(unsigned char* p, const MipVector v)
+{
+  const __m256i ints = _mm256_cvttps_epi32(v);
+  const __m128i shorts = _mm_packs_epi32(_mm256_castsi256_si128(ints), _mm256_extractf128_si256(ints, 1));
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_packus_epi16(shorts, shorts));
+}
+#else
+constexpr size_t MIP_LANES = 4;
+typedef __m128 MipVector;
+
+inline MipVector mipLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void mipStore(float* p, const MipVector v) { _mm_storeu_ps(p, v); }
+inline MipVector mipSet(const float v) { return _mm_set1_ps(v); }
+inline MipVector mipAdd(const MipVector a, const MipVector b) { return _mm_add_ps(a, b); }
+inline MipVector mipMul(const MipVector a, const MipVector b) { return _mm_mul_ps(a, b); }
+inline MipVector mipClamp(const MipVector v) { return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f)); }
+inline void mipStoreInts(int* p, const MipVector v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm_cvttps_epi32(v)); }
+
+inline void mipStoreBytes(unsigned char* p, const MipVector v)
+{
+  const __m128i shorts = _mm_packs_epi32(_mm_cvttps_epi32(v), _mm_setzero_si128());
+  const int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(shorts, shorts));
+  std::memcpy(p, &bytes, 4);
+}
+#endif
+
+// Row buffers have room for a 4 float load/store past the last value, so the horizontal pass
+// can treat every pixel as one 4 lane vector whatever the channel count
+constexpr size_t MIP_ROW_PADDING = 4;
+
+inline void _decodeRow(const unsigned char* in, const int width, const int channels, const MipOptions& options,
+                       float* out)
+{
+  const MipTables& tables = mipTables();
+  const float* decode[4];
+  for (int c = 0; c < channels; c++)
+  {
+    decode[c] = _isSrgbChannel(options, channels, c) ? tables.decodeSrgb : tables.decodeLinear;
+  }
+  for (int x = 0; x < width; x++, in += channels, out += channels)
+  {
+    for (int c = 0; c < channels; c++)
+      out[c] = decode[c][in[c]];
+  }
+}
+
+// Weighted sum of `taps` source rows, vectorised along the row
+inline void _filterRows(const float* const* rows, const MipKernel& kernel, const size_t count, float* out)
+{
+  MipVector weights[MIP_MAX_TAPS];
+  for (int k = 0; k < kernel.taps; k++)
+  {
+    weights[k] = mipSet(kernel.weights[k]);
+  }
+
+  size_t i = 0;
+  for (; i + MIP_LANES <= count; i += MIP_LANES)
+  {
+    MipVector sum = mipMul(mipLoad(rows[0] + i), weights[0]);
+    for (int k = 1; k < kernel.taps; k++)
+    {
+      sum = mipAdd(sum, mipMul(mipLoad(rows[k] + i), weights[k]));
+    }
+    mipStore(out + i, sum);
+  }
+  for (; i < count; i++)
+  {
+    float sum = 0.0f;
+    for (int k = 0; k < kernel.taps; k++)
+      sum += rows[k][i] * kernel.weights[k];
+    out[i] = sum;
+  }
+}
+
+// Weighted sum of `taps` neighbouring pixels, one pixel per SSE vector
+inline void _filterPixels(const float* row, const int width, const int channels, const MipKernel& kernel,
+                          const int outputWidth, float* out)
+{
+  __m128 weights[MIP_MAX_TAPS];
+  for (int k = 0; k < kernel.taps; k++)
+  {
+    weights[k] = _mm_set1_ps(kernel.weights[k]);
+  }
+
+  for (int x = 0; x < outputWidth; x++)
+  {
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < kernel.taps; k++)
+    {
+      const int sx = std::clamp(2 * x + kernel.offset + k, 0, width - 1);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + sx * channels), weights[k]));
+    }
+    // Lanes past the channel count are overwritten by the next pixel or land in the padding
+    _mm_storeu_ps(out + x * channels, sum);
+  }
+}
+
+inline void _encodeRow(const float* in, const size_t count, const int channels, const MipOptions& options,
+                       unsigned char* out)
+{
+  size_t i = 0;
+  if (!options.srgb || channels < 3)
+  {
+    const MipVector scale = mipSet(255.0f), half = mipSet(0.5f);
+    for (; i + MIP_LANES <= count; i += MIP_LANES)
+    {
+      mipStoreBytes(out + i, mipAdd(mipMul(mipClamp(mipLoad(in + i)), scale), half));
+    }
+    for (; i < count; i++)
+    {
+      out[i] = _encodeLinear(in[i]);
+    }
+    return;
+  }
+
+  // sRGB has no closed form worth vectorising: compute the table indices with SIMD, look up per value
+  const MipTables& tables = mipTables();
+  const MipVector scale = mipSet(MIP_ENCODE_TABLE_SIZE - 1), half = mipSet(0.5f);
+  alignas(32) int indices[MIP_LANES];
+  for (; i + MIP_LANES <= count; i += MIP_LANES)
+  {
+    mipStoreInts(indices, mipAdd(mipMul(mipClamp(mipLoad(in + i)), scale), half));
+    for (size_t lane = 0; lane < MIP_LANES; lane++)
+    {
+      const bool alpha = channels == 4 && (i + lane) % 4 == 3;
+      out[i + lane] = alpha ? _encodeLinear(in[i + lane]) : tables.encodeSrgb[indices[lane]];
+    }
+  }
+  for (; i < count; i++)
+  {
+    const bool alpha = channels == 4 && i % 4 == 3;
+    out[i] = alpha ? _encodeLinear(in[i]) : _encodeSrgb(in[i]);
+  }
+}
+
+// Produces output rows [firstRow, lastRow). Source rows are decoded to linear floats once into a
+// small ring, consecutive output rows share all but two of them.
+inline void _downsampleRows(const unsigned char* pixels, const int width, const int height, const int channels,
+                            const MipOptions& options, MipLevel& result, const int firstRow, const int lastRow)
+{
+  const MipKernel& kernel = mipKernel(options.filter);
+  const size_t rowFloats = static_cast<size_t>(width) * channels;
+  const size_t rowStride = rowFloats + MIP_ROW_PADDING;
+
+  std::vector<float> ring(kernel.taps * rowStride, 0.0f);
+  int ringRows[MIP_MAX_TAPS];
+  std::fill(ringRows, ringRows + MIP_MAX_TAPS, -1);
+  std::vector<float> vertical(rowStride, 0.0f), horizontal(static_cast<size_t>(result.width) * channels + MIP_ROW_PADDING);
+
+  for (int y = firstRow; y < lastRow; y++)
+  {
+    const float* rows[MIP_MAX_TAPS];
+    for (int k = 0; k < kernel.taps; k++)
+    {
+      // The taps are consecutive rows, so they never share a slot unless clamping made them the same row
+      const int sourceRow = std::clamp(2 * y + kernel.offset + k, 0, height - 1);
+      float* slot = ring.data() + (sourceRow % kernel.taps) * rowStride;
+      if (ringRows[sourceRow % kernel.taps] != sourceRow)
+      {
+        _decodeRow(pixels + sourceRow * rowFloats, width, channels, options, slot);
+        ringRows[sourceRow % kernel.taps] = sourceRow;
+      }
+      rows[k] = slot;
+    }
+
+    _filterRows(rows, kernel, rowFloats, vertical.data());
+    _filterPixels(vertical.data(), width, channels, kernel, result.width, horizontal.data());
+    _encodeRow(horizontal.data(), static_cast<size_t>(result.width) * channels, channels, options,
+               result.pixels.data() + static_cast<size_t>(y) * result.width * channels);
+  }
+}
+
+// Separable SIMD version of downsampleScalar, split into bands of rows across threads
+inline MipLevel downsample(const unsigned char* pixels, const int width, const int height, const int channels,
+                           const MipOptions& options = {})
+{
+  MipLevel result{std::max(1, width / 2), std::max(1, height / 2), {}};
+  result.pixels.resize(static_cast<size_t>(result.width) * result.height * channels);
+
+  // Small levels aren't worth a thread
+  constexpr int MIN_ROWS_PER_THREAD = 16;
+  const int bands = std::clamp<int>(result.height / MIN_ROWS_PER_THREAD, 1, std::max(1u, options.threadCount));
+  std::vector<std::thread> threads;
+  for (int band = 1; band < bands; band++)
+  {
+    threads.emplace_back(_downsampleRows, pixels, width, height, channels, std::cref(options), std::ref(result),
+                         result.height * band / bands, result.height * (band + 1) / bands);
+  }
+  _downsampleRows(pixels, width, height, channels, options, result, 0, result.height / bands);
+  for (std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  return result;
+}
+#else
+inline MipLevel downsample(const unsigned char* pixels, const int width, const int height, const int channels,
+                           const MipOptions& options = {})
+{
+  return downsampleScalar(pixels, width, height, channels, options);
+}
+#endif
+
+// Levels 1 and up, down to 1x1. Level 0 is the source image itself.
+inline std::vector<MipLevel> generateMipLevels(const unsigned char* pixels, const int width, const int height,
+                                               const int channels, const MipOptions& options = {})
+{
+  std::vector<MipLevel> levels;
+  int levelWidth = width, levelHeight = height;
+  while (levelWidth > 1 || levelHeight > 1)
+  {
+    levels.push_back(downsample(pixels, levelWidth, levelHeight, channels, options));
+    pixels = levels.back().pixels.data();
+    levelWidth = levels.back().width;
+    levelHeight = levels.back().height;
+  }
+  return levels;
+}
+
+// Full mip chain down to 1x1, level 0 being a copy of the source image
+inline std::vector<MipLevel> generateMipChain(const unsigned char* pixels, const int width, const int height,
+                                              const int channels, const MipOptions& options = {})
+{
+  std::vector<MipLevel> levels;
+  levels.push_back({width, height, std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * channels)});
+  for (MipLevel& level : generateMipLevels(pixels, width, height, channels, options))
+  {
+    levels.push_back(std::move(level));
+  }
+  return levels;
+}
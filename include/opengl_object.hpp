@@ -1,92 +1,135 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
 #include <vector>
 
+#include "gl_state.hpp"
+#include "vertex_layout.hpp"
+
 #include "ext/glad/glad.h"
 
 typedef unsigned int uint;
 
-struct VBOConfig
+// Index data narrowed to the smallest type that can address every vertex
+struct IndexData
 {
-  uint location, elementsPerItem;
+  std::vector<unsigned char> bytes;
+  GLenum type;
+  uint count;
 };
 
-typedef std::vector<VBOConfig> VBOConfigList;
+// 8-bit indices save little memory over 16-bit ones and are converted by the driver on some
+// hardware, so they are only picked when explicitly allowed.
+inline IndexData packIndices(const std::vector<uint>& indices, const uint vertexCount, const bool allowBytes = false)
+{
+  IndexData data{{}, GL_UNSIGNED_INT, static_cast<uint>(indices.size())};
+  size_t indexSize = sizeof(uint32_t);
+  if (allowBytes && vertexCount <= UINT8_MAX + 1)
+  {
+    data.type = GL_UNSIGNED_BYTE;
+    indexSize = sizeof(uint8_t);
+  }
+  else if (vertexCount <= UINT16_MAX + 1)
+  {
+    data.type = GL_UNSIGNED_SHORT;
+    indexSize = sizeof(uint16_t);
+  }
+
+  data.bytes.resize(indices.size() * indexSize);
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    switch (data.type)
+    {
+      case GL_UNSIGNED_BYTE:
+        data.bytes[i] = static_cast<uint8_t>(indices[i]);
+        break;
+      case GL_UNSIGNED_SHORT:
+      {
+        const auto index = static_cast<uint16_t>(indices[i]);
+        std::memcpy(&data.bytes[i * indexSize], &index, indexSize);
+        break;
+      }
+      default:
+        std::memcpy(&data.bytes[i * indexSize], &indices[i], indexSize);
+    }
+  }
+  return data;
+}
 
 class OpenGLObject
 {
-  std::vector<float> _vertices;
-  std::vector<uint> _indices;
+protected:
+  uint _vertexCount;
+  uint _indexCount = 0;
+  GLenum _indexType = GL_UNSIGNED_INT;
   // Vertex Array, Vertex and Element Buffer object IDs
   unsigned int VAO, VBO, EBO, stride;
 
   void _initVAO()
   {
     glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    glState().bindVertexArray(VAO);
   }
 
-  void _initVBO(const VBOConfigList& config)
+  void _initVBO(const void* vertices, const size_t size)
   {
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, _vertices.size() * sizeof(float), _vertices.data(), GL_STATIC_DRAW);
-
-    stride = 0;
-    for (int i = 0; i < config.size(); i++)
-    {
-      stride += config[i].elementsPerItem;
-    }
+    glState().bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
+  }
 
-    stride *= sizeof(float);
+  template <typename Vertex, typename... Attrs>
+  void _initVBO(const std::vector<Vertex>& vertices, VertexLayout<Attrs...>)
+  {
+    using Layout = VertexLayout<Attrs...>;
+    static_assert(Layout::template fits<Vertex>(), "Vertex type does not match its vertex layout");
 
-    for (int i = 0; i < config.size(); i++)
-    {
-      const auto [location, elementsPerItem] = config[i];
-      void *offset;
-      if (location == 0){
-        offset = reinterpret_cast<void*>(location);
-      } else {
-        const uint elementsInPrevItem = config[i-1].elementsPerItem;
-        offset = reinterpret_cast<void*>(elementsInPrevItem * location * sizeof(float));
-      }
-      glVertexAttribPointer(location, elementsPerItem, GL_FLOAT, GL_FALSE, stride, offset);
-      glEnableVertexAttribArray(location);
-    }
+    _initVBO(vertices.data(), vertices.size() * sizeof(Vertex));
+    Layout::apply();
+    stride = Layout::stride;
+    _vertexCount = vertices.size();
   }
 
-  void _initEBO() {
+  // Must run after _initVBO, the index type depends on the vertex count. Indices are uploaded in
+  // the order given; run the mesh through optimizeMesh first, reordering here would undo it.
+  void _initEBO(const std::vector<uint>& indices) {
+    const IndexData indexData = packIndices(indices, _vertexCount);
+    _indexCount = indexData.count;
+    _indexType = indexData.type;
+
     glGenBuffers(1, &EBO);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(uint), _indices.data(), GL_STATIC_DRAW);
+    glState().bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexData.bytes.size(), indexData.bytes.data(), GL_STATIC_DRAW);
   }
 
 public:
-  OpenGLObject(const std::vector<float>& vertices, const VBOConfigList& vboConfig)
+  // Vertices in any format described by a VertexLayout, e.g. with packed or normalized attributes
+  template <typename Vertex, typename... Attrs>
+  OpenGLObject(const std::vector<Vertex>& vertices, const VertexLayout<Attrs...> layout)
   {
-    _vertices = vertices;
     _initVAO();
-    _initVBO(vboConfig);
+    _initVBO(vertices, layout);
   }
 
-  OpenGLObject(const std::vector<float>& vertices, const std::vector<uint>& indices, const VBOConfigList& vboConfig)
+  template <typename Vertex, typename... Attrs>
+  OpenGLObject(const std::vector<Vertex>& vertices, const std::vector<uint>& indices,
+               const VertexLayout<Attrs...> layout)
   {
-    _vertices = vertices;
-    _indices = indices;
     _initVAO();
-    _initVBO(vboConfig);
-    _initEBO();
+    _initVBO(vertices, layout);
+    _initEBO(indices);
   }
 
+  [[nodiscard]] uint vertexCount() const { return _vertexCount; }
+
+  // The element buffer was bound while the VAO was, so binding the VAO brings it along
   void draw() const
   {
-    glBindVertexArray(VAO);
-    if (_indices.size() > 0) {
-      glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-      glDrawElements(GL_TRIANGLES, _indices.size(), GL_UNSIGNED_INT, nullptr);
+    glState().bindVertexArray(VAO);
+    if (_indexCount > 0) {
+      glDrawElements(GL_TRIANGLES, _indexCount, _indexType, nullptr);
     } else {
-      // Stores the points per triangle + texture coordinates and other vertex shader input params
-      const int elementsPerVertex = _vertices.size() / (stride / sizeof(float));
-      glDrawArrays(GL_TRIANGLES, 0, elementsPerVertex);
+      glDrawArrays(GL_TRIANGLES, 0, vertexCount());
     }
   }
 };
\ No newline at end of file
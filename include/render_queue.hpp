@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "worker_pool.hpp"
+
+typedef unsigned int uint;
+
+// Draw sort keys, most significant first: layer, program, material, depth. Sorting by key groups
+// draws by the state they need, so the queue changes programs and materials as rarely as
+// possible, and orders the draws of a material by depth.
+constexpr int SORT_KEY_DEPTH_BITS = 32;
+constexpr int SORT_KEY_MATERIAL_BITS = 16;
+constexpr int SORT_KEY_PROGRAM_BITS = 12;
+constexpr int SORT_KEY_LAYER_BITS = 4;
+static_assert(SORT_KEY_DEPTH_BITS + SORT_KEY_MATERIAL_BITS + SORT_KEY_PROGRAM_BITS + SORT_KEY_LAYER_BITS == 64);
+
+constexpr int SORT_KEY_MATERIAL_SHIFT = SORT_KEY_DEPTH_BITS;
+constexpr int SORT_KEY_PROGRAM_SHIFT = SORT_KEY_MATERIAL_SHIFT + SORT_KEY_MATERIAL_BITS;
+constexpr int SORT_KEY_LAYER_SHIFT = SORT_KEY_PROGRAM_SHIFT + SORT_KEY_PROGRAM_BITS;
+
+constexpr uint64_t sortKeyMask(const int bits) { return (uint64_t{1} << bits) - 1; }
+
+// Ids are truncated to their field's width
+constexpr uint64_t makeSortKey(const uint layer, const uint program, const uint material, const uint32_t depth)
+{
+  return (layer & sortKeyMask(SORT_KEY_LAYER_BITS)) << SORT_KEY_LAYER_SHIFT |
+         (program & sortKeyMask(SORT_KEY_PROGRAM_BITS)) << SORT_KEY_PROGRAM_SHIFT |
+         (material & sortKeyMask(SORT_KEY_MATERIAL_BITS)) << SORT_KEY_MATERIAL_SHIFT | depth;
+}
+
+constexpr uint sortKeyLayer(const uint64_t key) { return key >> SORT_KEY_LAYER_SHIFT; }
+constexpr uint sortKeyProgram(const uint64_t key)
+{
+  return key >> SORT_KEY_PROGRAM_SHIFT & sortKeyMask(SORT_KEY_PROGRAM_BITS);
+}
+constexpr uint sortKeyMaterial(const uint64_t key)
+{
+  return key >> SORT_KEY_MATERIAL_SHIFT & sortKeyMask(SORT_KEY_MATERIAL_BITS);
+}
+
+// Depth field for a view space distance. The bits of a non-negative float sort like its value, so
+// opaque draws go front to back (for early depth rejection); blended ones want back to front.
+inline uint32_t sortKeyDepth(const float distance, const bool backToFront = false)
+{
+  uint32_t bits;
+  const float clamped = std::max(distance, 0.0f);
+  std::memcpy(&bits, &clamped, sizeof(bits));
+  return backToFront ? ~bits : bits;
+}
+
+// What the GL thread needs to issue one draw. data points to whatever the backend draws it with
+// (mesh, model matrix, ...), owned by the caller and valid until the queue is submitted.
+struct DrawPacket
+{
+  uint64_t key;
+  const void* data;
+};
+
+static_assert(sizeof(DrawPacket) == 16);
+
+// Sorts packets by key, least significant byte first. A pass whose byte is the same for every
+// packet (unused layers, a single program, ...) is skipped.
+inline void radixSortPackets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch)
+{
+  const size_t count = packets.size();
+  if (count < 2)
+    return;
+
+  std::array<std::array<size_t, 256>, 8> counts{};
+  for (const DrawPacket& packet : packets)
+  {
+    for (int byte = 0; byte < 8; byte++)
+    {
+      counts[byte][packet.key >> byte * 8 & 0xFF]++;
+    }
+  }
+
+  scratch.resize(count);
+  DrawPacket* from = packets.data();
+  DrawPacket* to = scratch.data();
+  for (int byte = 0; byte < 8; byte++)
+  {
+    const int shift = byte * 8;
+    std::array<size_t, 256>& offsets = counts[byte];
+    if (offsets[from[0].key >> shift & 0xFF] == count)
+      continue;
+
+    size_t offset = 0;
+    for (size_t& bucket : offsets)
+    {
+      const size_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+      to[offsets[from[i].key >> shift & 0xFF]++] = from[i];
+    }
+    std::swap(from, to);
+  }
+
+  if (from != packets.data())
+    packets.swap(scratch);
+}
+
+// Packets recorded by one thread
+class alignas(64) DrawRecorder
+{
+  std::vector<DrawPacket> _packets;
+  friend class RenderQueue;
+
+public:
+  void push(const uint64_t key, const void* data) { _packets.push_back({key, data}); }
+};
+
+// State changes and draws of the last RenderQueue::submit()
+struct RenderQueueStats
+{
+  size_t draws = 0;
+  size_t layerChanges = 0;
+  size_t programChanges = 0;
+  size_t materialChanges = 0;
+};
+
+// Collects the draws of a frame from any number of threads and submits them in key order. Each
+// recording thread writes its own DrawRecorder, so recording needs no synchronisation; sort()
+// gathers and sorts them on one thread, and submit() replays them on the GL thread, telling the
+// backend only about the state that differs from the previous draw. record() runs on a pool of
+// threads owned by the queue, which sleep between frames.
+class RenderQueue
+{
+  WorkerPool _pool;
+  std::vector<DrawRecorder> _recorders;
+  std::vector<DrawPacket> _packets;
+  std::vector<DrawPacket> _scratch;
+
+public:
+  explicit RenderQueue(const uint threadCount = std::max(1u, std::thread::hardware_concurrency()))
+    : _pool(threadCount), _recorders(_pool.threadCount())
+  {
+  }
+
+  [[nodiscard]] uint threadCount() const { return static_cast<uint>(_recorders.size()); }
+
+  // For threads managed by the caller, one recorder per thread
+  DrawRecorder& recorder(const uint thread) { return _recorders[thread]; }
+
+  // Calls record(recorder, begin, end) for batches of itemCount items on the queue's threadCount()
+  // threads, the calling thread included. Batches are handed out one at a time.
+  template <typename Record>
+  void record(const size_t itemCount, Record record, const size_t batchSize = 1024)
+  {
+    const size_t batchCount = (itemCount + batchSize - 1) / batchSize;
+    _pool.run(batchCount, [&](const size_t batch, const uint thread) {
+      record(_recorders[thread], batch * batchSize, std::min(itemCount, (batch + 1) * batchSize));
+    });
+  }
+
+  // Gathers the recorded packets into key order
+  void sort()
+  {
+    size_t count = 0;
+    for (const DrawRecorder& recorder : _recorders)
+    {
+      count += recorder._packets.size();
+    }
+    _packets.clear();
+    _packets.reserve(count);
+    for (const DrawRecorder& recorder : _recorders)
+    {
+      _packets.insert(_packets.end(), recorder._packets.begin(), recorder._packets.end());
+    }
+    radixSortPackets(_packets, _scratch);
+  }
+
+  // Replays the sorted packets. Backend needs bindLayer(uint), bindProgram(uint),
+  // bindMaterial(uint) and draw(const DrawPacket&). A change of layer or program also rebinds
+  // the state below it in the key, which may depend on it.
+  template <typename Backend>
+  RenderQueueStats submit(Backend& backend) const
+  {
+    RenderQueueStats stats;
+    uint64_t previous = 0;
+    for (const DrawPacket& packet : _packets)
+    {
+      const bool first = stats.draws == 0;
+      const uint64_t changed = previous ^ packet.key;
+      if (first || sortKeyLayer(changed) != 0)
+      {
+        backend.bindLayer(sortKeyLayer(packet.key));
+        stats.layerChanges++;
+      }
+      if (first || (changed >> SORT_KEY_PROGRAM_SHIFT) != 0)
+      {
+        backend.bindProgram(sortKeyProgram(packet.key));
+        stats.programChanges++;
+      }
+      if (first || (changed >> SORT_KEY_MATERIAL_SHIFT) != 0)
+      {
+        backend.bindMaterial(sortKeyMaterial(packet.key));
+        stats.materialChanges++;
+      }
+      backend.draw(packet);
+      stats.draws++;
+      previous = packet.key;
+    }
+    return stats;
+  }
+
+  // Drops the packets, keeping the memory for the next frame
+  void clear()
+  {
+    for (DrawRecorder& recorder : _recorders)
+    {
+      recorder._packets.clear();
+    }
+    _packets.clear();
+  }
+
+  [[nodiscard]] const std::vector<DrawPacket>& packets() const { return _packets; }
+};
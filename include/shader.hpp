@@ -1,14 +1,126 @@
 #pragma once
 
+#include <cassert>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "gl_state.hpp"
+#include "uniform_cache.hpp"
 
 #include "ext/glad/glad.h"
 
+// Fixed binding points of the uniform blocks shared by every program
+enum UniformBlockBinding : unsigned int
+{
+  FRAME_DATA_BINDING = 0,
+};
+
+struct UniformBlockInfo
+{
+  const char *name;
+  UniformBlockBinding binding;
+};
+
+// Every Shader binds these blocks at link time, if the program declares them
+constexpr UniformBlockInfo SHARED_UNIFORM_BLOCKS[] = {
+  {"FrameData", FRAME_DATA_BINDING},
+};
+
+// An active uniform of a linked program, as reported by glGetActiveUniform
+struct UniformInfo
+{
+  std::string name;
+  int location;
+  GLenum type;
+  int size;
+};
+
+// Index of a uniform in a Shader's uniform table. Resolve it once with
+// Shader::getUniform and pass it to the setters instead of the uniform's name.
+struct UniformHandle
+{
+  int index = -1;
+
+  [[nodiscard]] bool valid() const { return index >= 0; }
+};
+
 class Shader
 {
+  std::vector<UniformInfo> _uniforms;
+  std::unordered_map<std::string, int> _uniformIndices; // By base name, for getUniform
+  mutable UniformCache _cache;
+
+  // Reads every active uniform into a flat table so setters never have to query GL by name
+  void _reflectUniforms()
+  {
+    int uniformCount, maxNameLength;
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(maxNameLength);
+    _uniforms.reserve(uniformCount);
+    for (int i = 0; i < uniformCount; i++)
+    {
+      int nameLength, size;
+      GLenum type;
+      glGetActiveUniform(programId, i, maxNameLength, &nameLength, &size, &type, nameBuffer.data());
+
+      // Uniforms in named blocks don't have a location and can't be set with glUniform*
+      const int location = glGetUniformLocation(programId, nameBuffer.data());
+      if (location < 0)
+      {
+        continue;
+      }
+
+      _uniforms.push_back({_baseName(std::string(nameBuffer.data(), nameLength)), location, type, size});
+      _uniformIndices.emplace(_uniforms.back().name, static_cast<int>(_uniforms.size()) - 1);
+    }
+    _cache.resize(_uniforms.size());
+  }
+
+  void _bindSharedUniformBlocks() const
+  {
+    for (const auto [name, binding] : SHARED_UNIFORM_BLOCKS)
+    {
+      const unsigned int blockIndex = glGetUniformBlockIndex(programId, name);
+      if (blockIndex != GL_INVALID_INDEX)
+      {
+        glUniformBlockBinding(programId, blockIndex, binding);
+      }
+    }
+  }
+
+  // Arrays are reported as "name[0]", but are looked up by their plain name
+  static std::string _baseName(const std::string &name)
+  {
+    if (name.size() > 3 && name.ends_with("[0]"))
+    {
+      return name.substr(0, name.size() - 3);
+    }
+    return name;
+  }
+
+  // Calls upload(location) unless the uniform already holds the value. Unknown uniforms are
+  // skipped entirely, since GL would silently ignore an upload to location -1 anyway.
+  template <typename Upload>
+  void _upload(const UniformHandle uniform, const void *value, const size_t size, Upload upload) const
+  {
+    if (!uniform.valid())
+    {
+      return;
+    }
+    assert(static_cast<size_t>(uniform.index) < _uniforms.size() && "UniformHandle of another Shader");
+
+    if (_cache.update(uniform.index, value, size))
+    {
+      upload(_uniforms[uniform.index].location);
+    }
+  }
+
 public:
   // Shader program ID
   unsigned int programId;
@@ -92,37 +204,84 @@ public:
 
     glDeleteShader(vertexId);
     glDeleteShader(fragmentId);
+
+    _reflectUniforms();
+    _bindSharedUniformBlocks();
+  }
+
+  [[nodiscard]] UniformHandle getUniform(const std::string &name) const
+  {
+    const auto found = _uniformIndices.find(_baseName(name));
+    if (found == _uniformIndices.end())
+    {
+      return {};
+    }
+    return {found->second};
   }
 
+  [[nodiscard]] const std::vector<UniformInfo>& uniforms() const { return _uniforms; }
+
+  // When disabled every set* call reaches the driver; the shadow values are still tracked
+  static void setRedundantUploadElision(const bool enabled) { UniformCache::setRedundantUploadElision(enabled); }
+  [[nodiscard]] static const UniformUploadStats& uploadStats() { return UniformCache::stats(); }
+  static void resetUploadStats() { UniformCache::resetStats(); }
+
+  // Goes through the state cache, using the program that is already in use costs nothing
   void use() const
   {
-    glUseProgram(programId);
+    glState().useProgram(programId);
+  }
+
+  void setBool(const UniformHandle uniform, const bool value) const
+  {
+    setInt(uniform, static_cast<int>(value));
+  }
+
+  void setInt(const UniformHandle uniform, const int value) const
+  {
+    _upload(uniform, &value, sizeof(int), [&](const int loc) { glUniform1i(loc, value); });
+  }
+
+  void setFloat(const UniformHandle uniform, const float value) const
+  {
+    _upload(uniform, &value, sizeof(float), [&](const int loc) { glUniform1f(loc, value); });
+  }
+
+  void setVec3(const UniformHandle uniform, const float *vec3) const
+  {
+    _upload(uniform, vec3, 3 * sizeof(float), [&](const int loc) { glUniform3fv(loc, 1, vec3); });
+  }
+
+  void setMat4(const UniformHandle uniform, const float *matrix) const
+  {
+    _upload(uniform, matrix, 16 * sizeof(float),
+            [&](const int loc) { glUniformMatrix4fv(loc, 1, GL_FALSE, matrix); });
   }
 
+  // Name based setters, convenient for one-off uploads outside of the render loop. Each call hashes
+  // the name, resolve a UniformHandle once for anything set every frame.
   void setBool(const std::string &name, const bool value) const
   {
-    glUniform1i(glGetUniformLocation(programId, name.c_str()), static_cast<int>(value));
+    setBool(getUniform(name), value);
   }
 
   void setInt(const std::string &name, const int value) const
   {
-    glUniform1i(glGetUniformLocation(programId, name.c_str()), value);
+    setInt(getUniform(name), value);
   }
 
   void setFloat(const std::string &name, const float value) const
   {
-    glUniform1f(glGetUniformLocation(programId, name.c_str()), value);
+    setFloat(getUniform(name), value);
   }
 
   void setVec3(const std::string &name, const float *vec3) const
   {
-    const auto loc = glGetUniformLocation(programId, name.c_str());
-    glUniform3fv(loc, 1, vec3);
+    setVec3(getUniform(name), vec3);
   }
 
   void setMat4(const std::string &name, const float *matrix) const
   {
-    const auto loc = glGetUniformLocation(programId, name.c_str());
-    glUniformMatrix4fv(loc, 1, GL_FALSE, matrix);
+    setMat4(getUniform(name), matrix);
   }
 };
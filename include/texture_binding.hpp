@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "gl_extensions.hpp"
+
+#include "ext/glad/glad.h"
+
+typedef unsigned int uint;
+
+// EXT_texture_filter_anisotropic, not part of core GL 3.3
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+// Filtering and wrapping state of a sampler object. Textures that are sampled the same way share
+// one sampler instead of each carrying its own copy of these parameters.
+struct SamplerState
+{
+  GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR;
+  GLenum magFilter = GL_LINEAR;
+  GLenum wrapS = GL_REPEAT;
+  GLenum wrapT = GL_REPEAT;
+  GLenum wrapR = GL_REPEAT;
+  float maxAnisotropy = 1.0f; // Ignored without EXT_texture_filter_anisotropic
+
+  [[nodiscard]] auto key() const { return std::tie(minFilter, magFilter, wrapS, wrapT, wrapR, maxAnisotropy); }
+  bool operator<(const SamplerState& other) const { return key() < other.key(); }
+};
+
+// Hands out one sampler object per distinct SamplerState. The samplers live as long as the cache.
+class SamplerCache
+{
+  std::map<SamplerState, uint> _samplers;
+  float _maxSupportedAnisotropy = 1.0f;
+
+public:
+  SamplerCache()
+  {
+    if (hasGLExtension("GL_EXT_texture_filter_anisotropic"))
+      glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &_maxSupportedAnisotropy);
+  }
+
+  ~SamplerCache()
+  {
+    for (const auto& [state, sampler] : _samplers)
+    {
+      glDeleteSamplers(1, &sampler);
+    }
+  }
+
+  SamplerCache(const SamplerCache&) = delete;
+  SamplerCache& operator=(const SamplerCache&) = delete;
+
+  uint get(const SamplerState& state)
+  {
+    if (const auto it = _samplers.find(state); it != _samplers.end())
+      return it->second;
+
+    uint sampler;
+    glGenSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, static_cast<int>(state.minFilter));
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, static_cast<int>(state.magFilter));
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, static_cast<int>(state.wrapS));
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, static_cast<int>(state.wrapT));
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, static_cast<int>(state.wrapR));
+    if (_maxSupportedAnisotropy > 1.0f && state.maxAnisotropy > 1.0f)
+    {
+      glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(state.maxAnisotropy, _maxSupportedAnisotropy));
+    }
+    _samplers.emplace(state, sampler);
+    return sampler;
+  }
+
+  [[nodiscard]] size_t size() const { return _samplers.size(); }
+};
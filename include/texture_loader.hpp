@@ -0,0 +1,434 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "baked_texture.hpp"
+#include "gl_state.hpp"
+#include "image_decoder.hpp"
+#include "texture_upload.hpp"
+
+#include "ext/glad/glad.h"
+
+// Loads 2D textures without blocking the GL thread on image decoding. load() hands back a
+// texture that holds a 1x1 placeholder until pump() finds the decoded image and uploads it.
+// Images that have a baked texture next to them (same name, BAKED_TEXTURE_EXTENSION) are
+// uploaded from that file right away instead, mips included. Otherwise the decoder threads also
+// generate the mip chain, so the GL thread only uploads and never runs glGenerateMipmap.
+//
+// loadArray() does the same for a GL_TEXTURE_2D_ARRAY with one image per layer, which is
+// uploaded once every layer has been decoded. All images of an array must have the same size.
+// If every layer has a baked texture in the same format, the array is built from those instead.
+class TextureLoader
+{
+  // What a decoder job is for, the job ID indexes _requests
+  struct Request
+  {
+    uint texture;
+    GLenum target;
+    int layer;
+    uint buffer = 0; // Pixel unpack buffer the image is decoded into, 0 if it comes back in memory
+    bool mapped = false; // The buffer is mapped until the decoded image is collected
+  };
+
+  // Decoded images of a texture, waiting for the other layers or for a free upload buffer
+  struct PendingTexture
+  {
+    uint texture;
+    GLenum target;
+    std::vector<DecodedImage> layers;
+    size_t missing;
+    bool failed = false;
+  };
+
+  ImageDecoder _decoder;
+  PixelUploadRing _uploadRing;
+  std::vector<Request> _requests;
+  std::vector<PendingTexture> _collecting; // Arrays with layers still decoding
+  std::deque<PendingTexture> _ready;
+  size_t _outstanding = 0;
+  const bool _decodeIntoBuffers;
+
+  // Where the baker puts the baked texture of an image
+  static std::string _bakedPath(const std::string& imagePath)
+  {
+    return std::filesystem::path(imagePath).replace_extension(BAKED_TEXTURE_EXTENSION).string();
+  }
+
+  // Levels of the full chain, which is what the decoder generates
+  static int _levelCount(const DecodedImage& image)
+  {
+    int levels = 1;
+    for (int size = std::max(image.width, image.height); size > 1; size /= 2)
+    {
+      levels++;
+    }
+    return levels;
+  }
+
+  [[nodiscard]] size_t _bytes(const DecodedImage& image) const
+  {
+    if (image.inSink)
+      return _decoder.sinkSize(image.width, image.height, image.channels);
+
+    size_t bytes = static_cast<size_t>(image.width) * image.height * image.channels;
+    for (const MipLevel& level : image.mipLevels)
+    {
+      bytes += level.pixels.size();
+    }
+    return bytes;
+  }
+
+  void _release(PendingTexture& texture)
+  {
+    for (DecodedImage& image : texture.layers)
+    {
+      stbi_image_free(image.pixels);
+      image.pixels = nullptr;
+      // Deleting right after the upload is fine, GL keeps the buffer alive until it has been read
+      uint& buffer = _requests[image.id].buffer;
+      if (buffer != 0)
+      {
+        glState().deleteBuffer(buffer);
+        buffer = 0;
+      }
+    }
+    _outstanding -= texture.layers.size();
+  }
+
+  // Files a decoded image under its texture, which is ready once it has all its layers
+  void _collect(DecodedImage image)
+  {
+    const Request request = _requests[image.id];
+    bool failed = image.failed();
+    if (request.buffer != 0)
+    {
+      _requests[image.id].mapped = false;
+      // The decoder is done writing. Unmapping fails if the contents were lost, e.g. on a mode switch.
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, request.buffer);
+      failed |= glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE;
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    if (failed)
+    {
+      std::cout << "Failed to load texture at: " << image.path << std::endl;
+    }
+
+    if (request.target == GL_TEXTURE_2D)
+    {
+      PendingTexture texture{request.texture, request.target, {}, 0, failed};
+      texture.layers.push_back(std::move(image));
+      _finish(texture);
+      return;
+    }
+
+    const auto it = std::find_if(_collecting.begin(), _collecting.end(),
+                                 [&](const PendingTexture& t) { return t.texture == request.texture; });
+    it->failed |= failed;
+    it->layers[request.layer] = std::move(image);
+    if (--it->missing == 0)
+    {
+      PendingTexture texture = std::move(*it);
+      _collecting.erase(it);
+      _finish(texture);
+    }
+  }
+
+  void _finish(PendingTexture& texture)
+  {
+    const DecodedImage& first = texture.layers[0];
+    for (const DecodedImage& layer : texture.layers)
+    {
+      if (!texture.failed && (layer.width != first.width || layer.height != first.height || layer.channels != first.channels))
+      {
+        std::cout << "ERROR::TEXTURE_LOADER::ARRAY_LAYERS_DIFFER " << layer.path << std::endl;
+        texture.failed = true;
+      }
+    }
+
+    if (texture.failed)
+    {
+      // Keeps showing the placeholder
+      _release(texture);
+      return;
+    }
+    _ready.push_back(std::move(texture));
+  }
+
+  // Issues the uploads of the layers that were decoded straight into their pixel buffers
+  void _uploadFromBuffers(const PendingTexture& texture)
+  {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, texture.layers[0].channels == 4 ? 4 : 1);
+    for (size_t layer = 0; layer < texture.layers.size(); layer++)
+    {
+      const DecodedImage& image = texture.layers[layer];
+      if (!image.inSink)
+        continue;
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, _requests[image.id].buffer);
+      size_t offset = 0;
+      int width = image.width, height = image.height;
+      for (int level = 0; level < _levelCount(image); level++)
+      {
+        // With a PBO bound the pointer argument is an offset into it
+        const auto data = reinterpret_cast<void*>(offset);
+        if (texture.target == GL_TEXTURE_2D_ARRAY)
+        {
+          glTexSubImage3D(texture.target, level, 0, 0, static_cast<int>(layer), width, height, 1,
+                          pixelFormat(image.channels), GL_UNSIGNED_BYTE, data);
+        }
+        else
+        {
+          glTexSubImage2D(texture.target, level, 0, 0, width, height, pixelFormat(image.channels), GL_UNSIGNED_BYTE, data);
+        }
+        offset += alignedLevelSize(width, height, image.channels);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+      }
+    }
+    glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  }
+
+  // Returns false if the upload ring is full, nothing has been changed then. Each layer goes the
+  // way it was decoded: mapping a buffer can fail for some layers of an array and not others.
+  bool _upload(const PendingTexture& texture)
+  {
+    const bool anyInMemory = std::any_of(texture.layers.begin(), texture.layers.end(),
+                                         [](const DecodedImage& layer) { return !layer.inSink; });
+    if (anyInMemory && !_uploadRing.ready())
+      return false;
+
+    std::vector<TextureLevelData> levels;
+    for (size_t layer = 0; layer < texture.layers.size(); layer++)
+    {
+      const DecodedImage& image = texture.layers[layer];
+      if (image.inSink)
+        continue;
+      levels.push_back({image.width, image.height, image.pixels, 0, static_cast<int>(layer)});
+      for (size_t i = 0; i < image.mipLevels.size(); i++)
+      {
+        const MipLevel& level = image.mipLevels[i];
+        levels.push_back({level.width, level.height, level.pixels.data(), static_cast<int>(i + 1), static_cast<int>(layer)});
+      }
+    }
+
+    // Replaces the placeholder. The source images are sRGB, but nothing downstream is gamma
+    // correct yet, so they are stored as plain RGB(A)8 like before.
+    const DecodedImage& image = texture.layers[0];
+    const GLenum internalFormat = sizedInternalFormat(image.channels, false);
+    const int levelCount = _levelCount(image);
+    glState().bindTextureForUpdate(texture.target, texture.texture);
+    if (texture.target == GL_TEXTURE_2D_ARRAY)
+    {
+      allocateTextureArrayStorage(levelCount, internalFormat, image.width, image.height,
+                                  static_cast<int>(texture.layers.size()));
+    }
+    else
+    {
+      allocateTextureStorage(levelCount, internalFormat, image.width, image.height);
+    }
+    _uploadFromBuffers(texture);
+    // The ring was ready, so a failed upload means its buffer couldn't be mapped
+    if (!levels.empty() && !_uploadRing.upload(texture.target, levels, pixelFormat(image.channels), image.channels))
+    {
+      uploadTextureLevels(texture.target, levels, pixelFormat(image.channels), image.channels);
+    }
+    return true;
+  }
+
+  uint _createPlaceholder(const GLenum target, const int layers)
+  {
+    static constexpr unsigned char PLACEHOLDER[] = {128, 128, 128, 255};
+
+    uint textureId;
+    glGenTextures(1, &textureId);
+    glState().bindTextureForUpdate(target, textureId);
+
+    // Wrapping and filtering come from the sampler bound with the texture, see SamplerCache
+    // Mutable on purpose, the real storage is allocated once the images arrive
+    if (target == GL_TEXTURE_2D_ARRAY)
+    {
+      std::vector<unsigned char> placeholders;
+      for (int layer = 0; layer < layers; layer++)
+      {
+        placeholders.insert(placeholders.end(), std::begin(PLACEHOLDER), std::end(PLACEHOLDER));
+      }
+      glTexImage3D(target, 0, GL_RGBA8, 1, 1, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholders.data());
+    }
+    else
+    {
+      glTexImage2D(target, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+    }
+    // Only level 0 exists, without this the mipmapped min filter makes the texture incomplete and
+    // it samples black. The storage allocation sets the real level count.
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 0);
+    return textureId;
+  }
+
+  void _submit(const uint texture, const GLenum target, const int layer, const char* imagePath)
+  {
+    Request request{texture, target, layer};
+    std::optional<ImageSink> sink;
+    int width, height, channels;
+    // Only the header is read here, the decoder reports unreadable images
+    if (_decodeIntoBuffers && stbi_info(imagePath, &width, &height, &channels))
+    {
+      // Mapped for the decoder thread to fill, unmapped again once the image comes back
+      const size_t size = _decoder.sinkSize(width, height, channels);
+      glGenBuffers(1, &request.buffer);
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, request.buffer);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+      auto* data = static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+                                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      if (data != nullptr)
+      {
+        sink = ImageSink{data, size};
+        request.mapped = true;
+      }
+      else
+      {
+        glState().deleteBuffer(request.buffer);
+        request.buffer = 0;
+      }
+    }
+
+    _decoder.submit(_requests.size(), imagePath, sink);
+    _requests.push_back(request);
+    _outstanding++;
+  }
+
+public:
+  // The source images are sRGB encoded colour, so by default mips are filtered in linear space.
+  // The decoder threads already work on separate images, one thread per image is enough.
+  static constexpr MipOptions DEFAULT_MIP_OPTIONS{MipFilter::Box, true, 1};
+
+  // RGB images are padded to RGBA while decoding: drivers store RGB8 as RGBA8 anyway, and
+  // converting on upload is slower than the extra bytes.
+  //
+  // With decodeIntoBuffers, every image gets a pixel unpack buffer mapped when it is submitted and
+  // the decoder writes the flipped, padded image and its mips straight into it. That skips the
+  // heap copy of the image and the copy into the upload ring. Without it, images come back in
+  // memory and are streamed through the ring.
+  explicit TextureLoader(const uint threadCount = std::max(1u, std::thread::hardware_concurrency()),
+                         const MipOptions& mipOptions = DEFAULT_MIP_OPTIONS, const bool padToRgba = true,
+                         const bool decodeIntoBuffers = true)
+    : _decoder(threadCount, 1024, mipOptions, padToRgba), _decodeIntoBuffers(decodeIntoBuffers)
+  {
+  }
+
+  // Must run on the GL thread while the context is current: the decoder threads are stopped before
+  // the buffers they write into are unmapped, then every buffer and image that is left is freed.
+  // The textures stay, like the ones that were uploaded.
+  ~TextureLoader()
+  {
+    _decoder.stop();
+    DecodedImage image;
+    while (_decoder.tryGetResult(image))
+    {
+      stbi_image_free(image.pixels);
+    }
+    for (const PendingTexture& texture : _collecting)
+    {
+      for (const DecodedImage& layer : texture.layers)
+      {
+        stbi_image_free(layer.pixels);
+      }
+    }
+    for (const PendingTexture& texture : _ready)
+    {
+      for (const DecodedImage& layer : texture.layers)
+      {
+        stbi_image_free(layer.pixels);
+      }
+    }
+
+    for (Request& request : _requests)
+    {
+      if (request.buffer == 0)
+        continue;
+      if (request.mapped)
+      {
+        glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, request.buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      }
+      glState().deleteBuffer(request.buffer);
+    }
+  }
+
+  TextureLoader(const TextureLoader&) = delete;
+  TextureLoader& operator=(const TextureLoader&) = delete;
+
+  // Must be called on the GL thread
+  uint load(const char* imagePath)
+  {
+    uint textureId;
+    if (!loadBakedTexture(_bakedPath(imagePath).c_str(), &textureId))
+    {
+      textureId = _createPlaceholder(GL_TEXTURE_2D, 1);
+      _submit(textureId, GL_TEXTURE_2D, 0, imagePath);
+    }
+    return textureId;
+  }
+
+  // Must be called on the GL thread. Layer i is imagePaths[i].
+  uint loadArray(const std::vector<std::string>& imagePaths)
+  {
+    std::vector<std::string> bakedPaths;
+    for (const std::string& imagePath : imagePaths)
+    {
+      bakedPaths.push_back(_bakedPath(imagePath));
+    }
+    uint bakedId;
+    if (loadBakedTextureArray(bakedPaths, &bakedId))
+      return bakedId;
+
+    const uint textureId = _createPlaceholder(GL_TEXTURE_2D_ARRAY, static_cast<int>(imagePaths.size()));
+    _collecting.push_back({textureId, GL_TEXTURE_2D_ARRAY, std::vector<DecodedImage>(imagePaths.size()), imagePaths.size()});
+    for (size_t layer = 0; layer < imagePaths.size(); layer++)
+    {
+      _submit(textureId, GL_TEXTURE_2D_ARRAY, static_cast<int>(layer), imagePaths[layer].c_str());
+    }
+    return textureId;
+  }
+
+  // Uploads decoded textures until maxUploads textures or byteBudget bytes have been uploaded,
+  // whichever comes first; at least one texture goes through if there is one. Must be called on
+  // the GL thread, e.g. once per frame. Returns the number of textures that were uploaded.
+  size_t pump(const size_t maxUploads = SIZE_MAX, const size_t byteBudget = SIZE_MAX)
+  {
+    DecodedImage image;
+    while (_decoder.tryGetResult(image))
+    {
+      _collect(std::move(image));
+      image = DecodedImage();
+    }
+
+    // Textures are bound on the state cache's update unit, the draws' bindings stay as they are
+    size_t uploads = 0, bytes = 0;
+    while (uploads < maxUploads && bytes < byteBudget && !_ready.empty())
+    {
+      PendingTexture& texture = _ready.front();
+      if (!_upload(texture))
+        break;
+      for (const DecodedImage& layer : texture.layers)
+      {
+        bytes += _bytes(layer);
+      }
+      _release(texture);
+      _ready.pop_front();
+      uploads++;
+    }
+    return uploads;
+  }
+
+  // Images submitted but not uploaded yet
+  [[nodiscard]] size_t pending() const { return _outstanding; }
+};
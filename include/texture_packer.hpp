@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "ext/glm/glm.hpp"
+
+typedef unsigned int uint;
+
+struct PackRect
+{
+  int x, y, width, height;
+};
+
+// Bottom-left skyline bin packer. The skyline is the top edge of everything placed so far, as
+// horizontal segments from left to right; a rectangle goes wherever it ends up lowest.
+class SkylinePacker
+{
+  struct Segment
+  {
+    int x, y, width;
+  };
+
+  int _width, _height;
+  std::vector<Segment> _skyline;
+  size_t _usedArea = 0;
+
+  // Height at which a rectangle starting at segment `index` would sit, -1 if it doesn't fit
+  [[nodiscard]] int _fit(const size_t index, const int width, const int height) const
+  {
+    const int x = _skyline[index].x;
+    if (x + width > _width)
+      return -1;
+
+    int y = 0, remaining = width;
+    for (size_t i = index; remaining > 0; i++)
+    {
+      y = std::max(y, _skyline[i].y);
+      if (y + height > _height)
+        return -1;
+      remaining -= _skyline[i].width;
+    }
+    return y;
+  }
+
+public:
+  SkylinePacker(const int width, const int height) : _width(width), _height(height)
+  {
+    _skyline.push_back({0, 0, width});
+  }
+
+  bool insert(const int width, const int height, PackRect* rect)
+  {
+    int bestTop = _height + 1, bestX = 0, bestY = 0;
+    size_t bestIndex = _skyline.size();
+    for (size_t i = 0; i < _skyline.size(); i++)
+    {
+      const int y = _fit(i, width, height);
+      if (y >= 0 && y + height < bestTop)
+      {
+        bestTop = y + height;
+        bestIndex = i;
+        bestX = _skyline[i].x;
+        bestY = y;
+      }
+    }
+    if (bestIndex == _skyline.size())
+      return false;
+
+    // The new segment covers the rectangle's top edge, cut away what it shadows
+    _skyline.insert(_skyline.begin() + bestIndex, {bestX, bestTop, width});
+    for (size_t i = bestIndex + 1; i < _skyline.size();)
+    {
+      const int shadowEnd = bestX + width;
+      if (_skyline[i].x >= shadowEnd)
+        break;
+      const int overlap = shadowEnd - _skyline[i].x;
+      if (overlap >= _skyline[i].width)
+      {
+        _skyline.erase(_skyline.begin() + i);
+        continue;
+      }
+      _skyline[i].x += overlap;
+      _skyline[i].width -= overlap;
+      break;
+    }
+
+    // Neighbours at the same height become one segment
+    for (size_t i = 0; i + 1 < _skyline.size();)
+    {
+      if (_skyline[i].y == _skyline[i + 1].y)
+      {
+        _skyline[i].width += _skyline[i + 1].width;
+        _skyline.erase(_skyline.begin() + i + 1);
+      }
+      else
+      {
+        i++;
+      }
+    }
+
+    *rect = {bestX, bestY, width, height};
+    _usedArea += static_cast<size_t>(width) * height;
+    return true;
+  }
+
+  [[nodiscard]] float occupancy() const
+  {
+    return static_cast<float>(_usedArea) / (static_cast<float>(_width) * _height);
+  }
+};
+
+struct TextureDesc
+{
+  int width, height, channels;
+};
+
+// One GL_TEXTURE_2D_ARRAY of the plan. Atlas arrays hold atlas pages as layers.
+struct PackedArray
+{
+  int width, height, channels, layers;
+  bool atlas;
+};
+
+// Where a texture ended up: its array, its layer, and the transform from the texture's own UVs
+// to the layer's (scale in xy, offset in zw) for atlas entries
+struct TexturePlacement
+{
+  uint array;
+  int layer;
+  PackRect rect; // Without the gutter, in layer pixels
+  glm::vec4 uvTransform;
+};
+
+struct TexturePackPlan
+{
+  std::vector<PackedArray> arrays;
+  std::vector<TexturePlacement> placements; // One per input texture, in input order
+};
+
+struct TexturePackOptions
+{
+  int atlasSize = 2048;
+  // Edge pixels are repeated this far around atlas entries, and entries are aligned to it, so
+  // mips down to log2(gutter) don't bleed neighbours into each other
+  int gutter = 8;
+  int minArrayLayers = 2; // Same-size groups smaller than this go into atlases
+  int maxArrayLayers = 256; // GL_MAX_ARRAY_TEXTURE_LAYERS is at least 256 in GL 3.3
+};
+
+// Groups textures into as few texture arrays as possible. Textures that share their size and
+// channel count with enough others become layers of an array of that size; the rest are packed
+// into atlas pages, and the pages of one channel count are layers of an atlas array. This only
+// plans: same-size arrays can be loaded with TextureLoader::loadArray, but building and uploading
+// atlas pages (with blitWithGutter) is left to the caller, nothing in the tree does it yet.
+inline TexturePackPlan planTexturePacking(const std::vector<TextureDesc>& textures, const TexturePackOptions& options = {})
+{
+  TexturePackPlan plan;
+  plan.placements.resize(textures.size());
+
+  std::map<std::tuple<int, int, int>, std::vector<size_t>> groups;
+  for (size_t i = 0; i < textures.size(); i++)
+  {
+    groups[{textures[i].width, textures[i].height, textures[i].channels}].push_back(i);
+  }
+
+  std::map<int, std::vector<size_t>> atlasEntries; // By channel count
+  for (const auto& [key, members] : groups)
+  {
+    const auto [width, height, channels] = key;
+    const bool fitsAtlas = width + 2 * options.gutter <= options.atlasSize && height + 2 * options.gutter <= options.atlasSize;
+    if (static_cast<int>(members.size()) < options.minArrayLayers && fitsAtlas)
+    {
+      atlasEntries[channels].insert(atlasEntries[channels].end(), members.begin(), members.end());
+      continue;
+    }
+
+    for (size_t first = 0; first < members.size(); first += options.maxArrayLayers)
+    {
+      const size_t count = std::min<size_t>(options.maxArrayLayers, members.size() - first);
+      plan.arrays.push_back({width, height, channels, static_cast<int>(count), false});
+      for (size_t layer = 0; layer < count; layer++)
+      {
+        plan.placements[members[first + layer]] = {static_cast<uint>(plan.arrays.size() - 1), static_cast<int>(layer),
+                                                   {0, 0, width, height}, glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)};
+      }
+    }
+  }
+
+  const auto alignUp = [&](const int value) { return (value + options.gutter - 1) / options.gutter * options.gutter; };
+  for (auto& [channels, entries] : atlasEntries)
+  {
+    // Tallest first packs skylines much tighter
+    std::sort(entries.begin(), entries.end(), [&](const size_t a, const size_t b) {
+      return textures[a].height != textures[b].height ? textures[a].height > textures[b].height : textures[a].width > textures[b].width;
+    });
+
+    std::vector<SkylinePacker> pages;
+    const auto atlasIndex = static_cast<uint>(plan.arrays.size());
+    for (const size_t entry : entries)
+    {
+      const int paddedWidth = alignUp(textures[entry].width + 2 * options.gutter);
+      const int paddedHeight = alignUp(textures[entry].height + 2 * options.gutter);
+      PackRect rect{};
+      size_t page = 0;
+      while (page < pages.size() && !pages[page].insert(paddedWidth, paddedHeight, &rect))
+        page++;
+      if (page == pages.size())
+      {
+        pages.emplace_back(options.atlasSize, options.atlasSize);
+        pages.back().insert(paddedWidth, paddedHeight, &rect);
+      }
+
+      const PackRect inner{rect.x + options.gutter, rect.y + options.gutter, textures[entry].width, textures[entry].height};
+      const float size = static_cast<float>(options.atlasSize);
+      plan.placements[entry] = {atlasIndex, static_cast<int>(page), inner,
+                                glm::vec4(inner.width / size, inner.height / size, inner.x / size, inner.y / size)};
+    }
+    plan.arrays.push_back({options.atlasSize, options.atlasSize, channels, static_cast<int>(pages.size()), true});
+  }
+  return plan;
+}
+
+// Copies a texture into its place on an atlas layer and repeats its edge pixels into the gutter
+inline void blitWithGutter(const unsigned char* pixels, const TexturePlacement& placement, const int channels,
+                           const int gutter, unsigned char* layer, const int layerWidth, const int layerHeight)
+{
+  const PackRect& rect = placement.rect;
+  for (int y = -gutter; y < rect.height + gutter; y++)
+  {
+    const int targetY = rect.y + y;
+    if (targetY < 0 || targetY >= layerHeight)
+      continue;
+    const int sourceY = std::clamp(y, 0, rect.height - 1);
+    for (int x = -gutter; x < rect.width + gutter; x++)
+    {
+      const int targetX = rect.x + x;
+      if (targetX < 0 || targetX >= layerWidth)
+        continue;
+      const int sourceX = std::clamp(x, 0, rect.width - 1);
+      std::memcpy(layer + (static_cast<size_t>(targetY) * layerWidth + targetX) * channels,
+                  pixels + (static_cast<size_t>(sourceY) * rect.width + sourceX) * channels, channels);
+    }
+  }
+}
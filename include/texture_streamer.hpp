@@ -0,0 +1,290 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "baked_texture.hpp"
+#include "gl_state.hpp"
+
+#include "ext/glad/glad.h"
+#include "ext/glm/glm.hpp"
+
+typedef unsigned int uint;
+
+struct TextureStreamingOptions
+{
+  size_t budgetBytes = 256 << 20;        // Resident texture memory the streamer tries to stay under
+  size_t uploadBytesPerFrame = 8 << 20;  // At least one level is uploaded per frame regardless
+  uint tailSize = 64; // Levels this size and smaller are loaded up front and never evicted
+};
+
+struct TextureStreamingStats
+{
+  size_t residentBytes = 0;
+  size_t pendingRequests = 0; // Textures that wanted more levels than could be uploaded
+  uint64_t evictions = 0;     // Levels evicted since the streamer was created
+  float evictionsPerSecond = 0.0f; // Over the last full second
+};
+
+// Diameter in pixels of a sphere at `distance` from the camera, for TextureStreamer::request
+inline float projectedDiameter(const glm::mat4& projection, const float radius, const float distance,
+                               const int viewportHeight)
+{
+  // projection[1][1] is 1 / tan(fovY / 2) for a perspective projection, which maps to half the viewport
+  return radius / std::max(distance, 1e-4f) * projection[1][1] * static_cast<float>(viewportHeight);
+}
+
+// The GL calls TextureStreamer makes. The streaming decisions only see this interface, so tests
+// can drive them with a backend that records levels instead of uploading them.
+struct GLTextureStreamingBackend
+{
+  // A texture for every level of file, none of them defined yet
+  uint create(const BakedTextureFile& file)
+  {
+    uint texture;
+    glGenTextures(1, &texture);
+    glState().bindTextureForUpdate(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<int>(file.header().levelCount) - 1);
+    return texture;
+  }
+
+  // Uploads level, the one above the current base level, and makes it the base. Returns the GPU
+  // bytes it takes.
+  size_t loadLevel(const uint texture, const BakedTextureFile& file, const int level)
+  {
+    glState().bindTextureForUpdate(GL_TEXTURE_2D, texture);
+    const size_t bytes = uploadBakedLevel(file, static_cast<uint32_t>(level));
+    // Only lowered once the level is defined, so the texture stays complete
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    return bytes;
+  }
+
+  // Frees level, the current base level, and makes the next one the base
+  void evictLevel(const uint texture, const int level)
+  {
+    glState().bindTextureForUpdate(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    // Levels outside BASE_LEVEL..MAX_LEVEL don't take part in completeness, so the format is irrelevant
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  }
+
+  void destroy(const uint texture) { glState().deleteTexture(texture); }
+};
+
+// Streams the mip levels of baked textures in and out of GPU memory as they are needed. add()
+// maps the file and uploads only the mip tail, so a texture is usable right away in low detail.
+// Every frame the renderer tells the streamer how big the objects using a texture are on screen,
+// and update() uploads the missing levels down to the one that matches that size, a level per
+// texture at a time and the most blurry textures first, within a per-frame upload budget.
+//
+// The resident levels are selected with GL_TEXTURE_BASE_LEVEL, so the texture name never changes
+// and levels can be added and dropped individually. This needs mutable storage: levels below
+// the base level are left undefined, or redefined as empty to hand their memory back. When the
+// resident levels exceed the budget, the high levels of the least recently used textures that
+// don't need them any more are evicted first.
+template <typename Backend>
+class BasicTextureStreamer
+{
+  struct StreamedTexture
+  {
+    std::unique_ptr<BakedTextureFile> file;
+    uint texture;
+    int residentBase; // Levels residentBase.. are resident
+    int tailBase;     // First level of the mip tail
+    int wantedBase;   // Finest level requested this frame
+    uint64_t lastUsedFrame;
+    std::vector<size_t> levelBytes; // GPU bytes of each resident level, 0 otherwise
+  };
+
+  TextureStreamingOptions _options;
+  Backend _backend;
+  std::vector<StreamedTexture> _textures;
+  size_t _residentBytes = 0;
+  uint64_t _frame = 0;
+  size_t _pendingRequests = 0;
+  uint64_t _evictions = 0;
+  uint64_t _windowEvictions = 0;
+  double _windowStart = -1.0;
+  float _evictionsPerSecond = 0.0f;
+
+  void _loadLevel(StreamedTexture& texture, const int level)
+  {
+    texture.levelBytes[level] = _backend.loadLevel(texture.texture, *texture.file, level);
+    texture.residentBase = level;
+    _residentBytes += texture.levelBytes[level];
+  }
+
+  void _evictLevel(StreamedTexture& texture)
+  {
+    const int level = texture.residentBase;
+    _backend.evictLevel(texture.texture, level);
+    texture.residentBase = level + 1;
+    _residentBytes -= texture.levelBytes[level];
+    texture.levelBytes[level] = 0;
+    _evictions++;
+    _windowEvictions++;
+  }
+
+  // Evicts levels that aren't wanted this frame, least recently used textures first, until bytes
+  // more fit into the budget. Returns false if they still don't.
+  bool _makeRoom(const size_t bytes, const StreamedTexture* keep)
+  {
+    while (_residentBytes + bytes > _options.budgetBytes)
+    {
+      StreamedTexture* victim = nullptr;
+      for (StreamedTexture& texture : _textures)
+      {
+        if (&texture == keep || texture.residentBase >= texture.wantedBase)
+          continue;
+        if (victim == nullptr || texture.lastUsedFrame < victim->lastUsedFrame)
+          victim = &texture;
+      }
+      if (victim == nullptr)
+        return false;
+      _evictLevel(*victim);
+    }
+    return true;
+  }
+
+  [[nodiscard]] static size_t _levelSize(const StreamedTexture& texture, const int level)
+  {
+    return texture.file->level(static_cast<uint32_t>(level)).size;
+  }
+
+public:
+  explicit BasicTextureStreamer(const TextureStreamingOptions& options = {}, Backend backend = {})
+    : _options(options), _backend(std::move(backend))
+  {
+  }
+
+  ~BasicTextureStreamer()
+  {
+    for (const StreamedTexture& texture : _textures)
+    {
+      _backend.destroy(texture.texture);
+    }
+  }
+
+  BasicTextureStreamer(const BasicTextureStreamer&) = delete;
+  BasicTextureStreamer& operator=(const BasicTextureStreamer&) = delete;
+
+  // Maps a baked texture and uploads its mip tail. Returns false if the file is missing or
+  // invalid. Must be called on the GL thread.
+  bool add(const char* path, uint* handle)
+  {
+    auto file = std::make_unique<BakedTextureFile>(path);
+    if (!file->valid())
+      return false;
+
+    const BakedTextureHeader& header = file->header();
+    const auto levelCount = static_cast<int>(header.levelCount);
+    int tailBase = levelCount - 1;
+    while (tailBase > 0 && std::max(file->level(tailBase - 1).width, file->level(tailBase - 1).height) <= _options.tailSize)
+    {
+      tailBase--;
+    }
+
+    StreamedTexture texture{std::move(file), 0, levelCount, tailBase, tailBase, _frame, std::vector<size_t>(levelCount)};
+    texture.texture = _backend.create(*texture.file);
+    for (int level = levelCount - 1; level >= tailBase; level--)
+    {
+      _loadLevel(texture, level);
+    }
+
+    *handle = _textures.size();
+    _textures.push_back(std::move(texture));
+    return true;
+  }
+
+  // GL texture of a streamed texture, to bind for drawing
+  [[nodiscard]] uint texture(const uint handle) const { return _textures[handle].texture; }
+
+  // First resident level of a streamed texture
+  [[nodiscard]] int residentBase(const uint handle) const { return _textures[handle].residentBase; }
+
+  [[nodiscard]] const Backend& backend() const { return _backend; }
+
+  // Records that an object covering screenSize pixels (across its widest extent) uses the texture
+  // this frame. The texture is wanted at the level that maps about one texel to a pixel.
+  void request(const uint handle, const float screenSize)
+  {
+    StreamedTexture& texture = _textures[handle];
+    texture.lastUsedFrame = _frame;
+    if (screenSize <= 0.0f)
+      return;
+
+    const BakedTextureHeader& header = texture.file->header();
+    const float texels = static_cast<float>(std::max(header.width, header.height));
+    const int level = static_cast<int>(std::floor(std::log2(std::max(texels / screenSize, 1.0f))));
+    texture.wantedBase = std::min(texture.wantedBase, std::min(level, texture.tailBase));
+  }
+
+  // Uploads wanted levels and evicts unwanted ones for this frame's requests. Call once per frame
+  // on the GL thread, after the requests; time is in seconds.
+  void update(const double time)
+  {
+    // Textures furthest from what they want go first, each gets one level per pass
+    std::vector<StreamedTexture*> wanting;
+    for (StreamedTexture& texture : _textures)
+    {
+      if (texture.wantedBase < texture.residentBase)
+        wanting.push_back(&texture);
+    }
+    std::sort(wanting.begin(), wanting.end(), [](const StreamedTexture* a, const StreamedTexture* b) {
+      return a->residentBase - a->wantedBase > b->residentBase - b->wantedBase;
+    });
+
+    size_t uploaded = 0;
+    bool progress = true;
+    while (progress && uploaded < _options.uploadBytesPerFrame)
+    {
+      progress = false;
+      for (StreamedTexture* texture : wanting)
+      {
+        if (texture->wantedBase >= texture->residentBase || uploaded >= _options.uploadBytesPerFrame)
+          continue;
+        const int level = texture->residentBase - 1;
+        if (!_makeRoom(_levelSize(*texture, level), texture))
+          continue;
+        _loadLevel(*texture, level);
+        uploaded += texture->levelBytes[level];
+        progress = true;
+      }
+    }
+
+    // Also give back memory other textures could use for levels that are still wanted
+    if (_residentBytes > _options.budgetBytes)
+      _makeRoom(0, nullptr);
+
+    if (_windowStart < 0.0)
+      _windowStart = time;
+    if (time - _windowStart >= 1.0)
+    {
+      _evictionsPerSecond = static_cast<float>(static_cast<double>(_windowEvictions) / (time - _windowStart));
+      _windowEvictions = 0;
+      _windowStart = time;
+    }
+
+    // Requests are per frame, textures nobody asks for next frame only need their tail
+    _pendingRequests = 0;
+    for (StreamedTexture& texture : _textures)
+    {
+      if (texture.wantedBase < texture.residentBase)
+        _pendingRequests++;
+      texture.wantedBase = texture.tailBase;
+    }
+    _frame++;
+  }
+
+  // As of the last update()
+  [[nodiscard]] TextureStreamingStats stats() const
+  {
+    return {_residentBytes, _pendingRequests, _evictions, _evictionsPerSecond};
+  }
+};
+
+using TextureStreamer = BasicTextureStreamer<GLTextureStreamingBackend>;
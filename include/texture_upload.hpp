@@ -0,0 +1,218 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "gl_extensions.hpp"
+#include "gl_state.hpp"
+
+#include "ext/glad/glad.h"
+
+typedef unsigned int uint;
+
+// Pixel transfer format of 8-bit images with 1-4 channels
+inline GLenum pixelFormat(const int channels)
+{
+  switch (channels)
+  {
+    case 1: return GL_RED;
+    case 2: return GL_RG;
+    case 3: return GL_RGB;
+    default: return GL_RGBA;
+  }
+}
+
+// Sized internal format for 8-bit images with 1-4 channels. Unsized formats like GL_RGB leave the
+// choice to the driver, and one or two channel sRGB formats don't exist.
+inline GLenum sizedInternalFormat(const int channels, const bool srgb)
+{
+  switch (channels)
+  {
+    case 1: return GL_R8;
+    case 2: return GL_RG8;
+    case 3: return srgb ? GL_SRGB8 : GL_RGB8;
+    default: return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  }
+}
+
+// Allocates every level of the bound 2D texture at once. With ARB_texture_storage the texture
+// becomes immutable, so the driver can skip its completeness checks on every bind. Otherwise the
+// levels are specified one by one, which gives the same layout without the guarantee.
+inline void allocateTextureStorage(const int levels, const GLenum internalFormat, const int width, const int height)
+{
+  if (glExtensions.texStorage2D != nullptr)
+  {
+    glExtensions.texStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+  }
+  else
+  {
+    // Any format/type pair works, no data is transferred
+    for (int level = 0; level < levels; level++)
+    {
+      glTexImage2D(GL_TEXTURE_2D, level, static_cast<int>(internalFormat), std::max(1, width >> level),
+                   std::max(1, height >> level), 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+// Same for a GL_TEXTURE_2D_ARRAY with `layers` layers
+inline void allocateTextureArrayStorage(const int levels, const GLenum internalFormat, const int width, const int height,
+                                        const int layers)
+{
+  if (glExtensions.texStorage3D != nullptr)
+  {
+    glExtensions.texStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, width, height, layers);
+  }
+  else
+  {
+    for (int level = 0; level < levels; level++)
+    {
+      glTexImage3D(GL_TEXTURE_2D_ARRAY, level, static_cast<int>(internalFormat), std::max(1, width >> level),
+                   std::max(1, height >> level), layers, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    }
+  }
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+// Pixel data of one level (of one array layer) as the upload ring sees it, rows tightly packed
+struct TextureLevelData
+{
+  int width, height;
+  const unsigned char* pixels;
+  int level = 0;
+  int layer = 0; // Ignored for GL_TEXTURE_2D
+};
+
+// Issues the glTexSubImage call of one level. data is a pointer to the pixels, or an offset into
+// the pixel unpack buffer if one is bound.
+inline void texSubImageLevel(const GLenum target, const TextureLevelData& level, const GLenum format, const void* data)
+{
+  if (target == GL_TEXTURE_2D_ARRAY)
+  {
+    glTexSubImage3D(target, level.level, 0, 0, level.layer, level.width, level.height, 1, format, GL_UNSIGNED_BYTE,
+                    data);
+  }
+  else
+  {
+    glTexSubImage2D(target, level.level, 0, 0, level.width, level.height, format, GL_UNSIGNED_BYTE, data);
+  }
+}
+
+// Uploads the levels to the texture bound to target straight from client memory, which blocks
+// until the driver has copied them. The fallback for when the upload ring can't map its buffer.
+inline void uploadTextureLevels(const GLenum target, const std::vector<TextureLevelData>& levels, const GLenum format,
+                                const int channels)
+{
+  glPixelStorei(GL_UNPACK_ALIGNMENT, channels == 4 ? 4 : 1);
+  for (const TextureLevelData& level : levels)
+  {
+    texSubImageLevel(target, level, format, level.pixels);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// A ring of pixel buffer objects that texture data is streamed through. upload() copies the
+// levels into the next free PBO and issues glTexSubImage2D from it, which returns as soon as the
+// commands are queued; the driver copies into the texture asynchronously. A fence after every
+// upload tells when the PBO can be written again, so the CPU never waits on a busy buffer.
+class PixelUploadRing
+{
+  struct Slot
+  {
+    uint buffer = 0;
+    size_t capacity = 0;
+    GLsync fence = nullptr;
+  };
+
+  std::vector<Slot> _slots;
+  size_t _next = 0;
+
+  static bool _isFree(Slot& slot)
+  {
+    if (slot.fence == nullptr)
+      return true;
+    const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      return false;
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    return true;
+  }
+
+public:
+  // The slots start out with initialCapacity bytes and grow to fit the largest upload they see
+  explicit PixelUploadRing(const size_t slotCount = 3, const size_t initialCapacity = 4 << 20)
+    : _slots(slotCount)
+  {
+    for (Slot& slot : _slots)
+    {
+      glGenBuffers(1, &slot.buffer);
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(initialCapacity), nullptr, GL_STREAM_DRAW);
+      slot.capacity = initialCapacity;
+    }
+    glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  // True if the next upload won't have to wait for the GPU
+  bool ready() { return _isFree(_slots[_next]); }
+
+  // Uploads the levels to the texture bound to target, GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY.
+  // Returns false without uploading anything if every PBO is still being read by the GPU, or if the
+  // PBO can't be mapped, e.g. on GL_OUT_OF_MEMORY. After ready() only the latter is possible, and
+  // the levels can go through uploadTextureLevels() instead.
+  bool upload(const GLenum target, const std::vector<TextureLevelData>& levels, const GLenum format, const int channels)
+  {
+    Slot& slot = _slots[_next];
+    if (!_isFree(slot))
+      return false;
+    _next = (_next + 1) % _slots.size();
+
+    // Each level starts 4-byte aligned, rows are tightly packed
+    std::vector<size_t> offsets;
+    size_t size = 0;
+    for (const TextureLevelData& level : levels)
+    {
+      offsets.push_back(size);
+      size += (static_cast<size_t>(level.width) * level.height * channels + 3) & ~static_cast<size_t>(3);
+    }
+
+    glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+    if (size > slot.capacity)
+    {
+      slot.capacity = size;
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    }
+
+    // The fence says the GPU is done with the old contents, there is nothing to synchronise
+    auto* mapped = static_cast<unsigned char*>(glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (mapped == nullptr)
+    {
+      glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return false;
+    }
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+      std::memcpy(mapped + offsets[i], levels[i].pixels, static_cast<size_t>(levels[i].width) * levels[i].height * channels);
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, channels == 4 ? 4 : 1);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+      // With a PBO bound the pointer argument is an offset into it
+      texSubImageLevel(target, levels[i], format, reinterpret_cast<void*>(offsets[i]));
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glState().bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return true;
+  }
+
+  [[nodiscard]] size_t slotCount() const { return _slots.size(); }
+};
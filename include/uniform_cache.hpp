@@ -0,0 +1,59 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Uniform uploads issued and skipped across all shaders since the last reset
+struct UniformUploadStats
+{
+  uint64_t uploads = 0;
+  uint64_t elided = 0;
+};
+
+// CPU copy of the last value uploaded to each uniform of a program. Uniform values are
+// per-program state, so a value stays valid across glUseProgram switches. The cache doesn't call
+// GL itself: the owner uploads whenever update() says the driver doesn't have the value yet.
+class UniformCache
+{
+  struct Shadow
+  {
+    std::array<unsigned char, 16 * sizeof(float)> value;
+    bool valid = false;
+  };
+
+  std::vector<Shadow> _shadows;
+
+  static inline bool _elideRedundantUploads = true;
+  static inline UniformUploadStats _stats;
+
+public:
+  static constexpr size_t MAX_VALUE_SIZE = sizeof(Shadow::value);
+
+  explicit UniformCache(const size_t uniformCount = 0) : _shadows(uniformCount) {}
+
+  void resize(const size_t uniformCount) { _shadows.resize(uniformCount); }
+  [[nodiscard]] size_t size() const { return _shadows.size(); }
+
+  // Records size bytes at value as the value of uniform index. Returns false if the uniform
+  // already holds it and the upload can be skipped.
+  bool update(const size_t index, const void* value, const size_t size)
+  {
+    Shadow& shadow = _shadows[index];
+    if (_elideRedundantUploads && shadow.valid && std::memcmp(shadow.value.data(), value, size) == 0)
+    {
+      _stats.elided++;
+      return false;
+    }
+
+    std::memcpy(shadow.value.data(), value, size);
+    shadow.valid = true;
+    _stats.uploads++;
+    return true;
+  }
+
+  // When disabled every update reaches the driver; the shadow values are still tracked
+  static void setRedundantUploadElision(const bool enabled) { _elideRedundantUploads = enabled; }
+  [[nodiscard]] static const UniformUploadStats& stats() { return _stats; }
+  static void resetStats() { _stats = {}; }
+};
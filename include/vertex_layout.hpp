@@ -0,0 +1,240 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "ext/glad/glad.h"
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/packing.hpp"
+#include "ext/glm/gtc/type_precision.hpp"
+
+// Attribute semantics. Each one is bound to a fixed location that the shaders declare
+// with `layout (location = N)`. Locations from 4 upwards are left for per-instance data.
+struct Position { static constexpr unsigned int location = 0; };
+struct UV { static constexpr unsigned int location = 1; };
+struct Normal { static constexpr unsigned int location = 2; };
+struct Colour { static constexpr unsigned int location = 3; };
+
+// The demos create a GL 3.3 context, which converts a b-bit snorm value c to (2c + 1) / (2^b - 1):
+// -1 and 1 are exact, 0 is not. GL 4.2 changed the rule to max(c / (2^(b-1) - 1), -1), which is at
+// most half a step away. Encoding inverts the 3.3 rule so the error stays within half a step.
+inline int encodeSnorm(const float value, const int bits)
+{
+  const auto maxCode = static_cast<float>((1 << bits) - 1);
+  const auto code = static_cast<int>(std::round((std::clamp(value, -1.0f, 1.0f) * maxCode - 1.0f) * 0.5f));
+  return std::clamp(code, -(1 << (bits - 1)), (1 << (bits - 1)) - 1);
+}
+
+inline float decodeSnorm(const int code, const int bits)
+{
+  return static_cast<float>(2 * code + 1) / static_cast<float>((1 << bits) - 1);
+}
+
+// Attribute formats: how a value is stored in the vertex buffer and how the vertex fetch
+// converts it back into the float vector the shader sees. `pack` encodes a float vector
+// into the stored representation.
+template <typename StorageType, GLenum Type, int Components, bool Normalized>
+struct AttributeFormat
+{
+  using Storage = StorageType;
+  static constexpr GLenum type = Type;
+  static constexpr int components = Components;
+  static constexpr bool normalized = Normalized;
+  static constexpr size_t size = sizeof(Storage);
+
+  // Attributes that are not 4-byte aligned are fetched through a slow path by most drivers
+  static_assert(size % 4 == 0, "Vertex attributes must be a multiple of 4 bytes");
+};
+
+struct Float2 : AttributeFormat<glm::vec2, GL_FLOAT, 2, false>
+{
+  static Storage pack(const glm::vec2& v) { return v; }
+};
+
+struct Float3 : AttributeFormat<glm::vec3, GL_FLOAT, 3, false>
+{
+  static Storage pack(const glm::vec3& v) { return v; }
+};
+
+struct Float4 : AttributeFormat<glm::vec4, GL_FLOAT, 4, false>
+{
+  static Storage pack(const glm::vec4& v) { return v; }
+};
+
+struct Half2 : AttributeFormat<glm::u16vec2, GL_HALF_FLOAT, 2, false>
+{
+  static Storage pack(const glm::vec2& v) { return {glm::packHalf1x16(v.x), glm::packHalf1x16(v.y)}; }
+};
+
+struct Half4 : AttributeFormat<glm::u16vec4, GL_HALF_FLOAT, 4, false>
+{
+  static Storage pack(const glm::vec4& v)
+  {
+    return {glm::packHalf1x16(v.x), glm::packHalf1x16(v.y), glm::packHalf1x16(v.z), glm::packHalf1x16(v.w)};
+  }
+};
+
+// Signed normalized 16-bit values in [-1, 1]; the fourth component keeps the attribute aligned
+struct Snorm16x4 : AttributeFormat<glm::i16vec4, GL_SHORT, 4, true>
+{
+  static Storage pack(const glm::vec4& v)
+  {
+    return Storage(encodeSnorm(v.x, 16), encodeSnorm(v.y, 16), encodeSnorm(v.z, 16), encodeSnorm(v.w, 16));
+  }
+};
+
+// Unsigned normalized 16-bit values in [0, 1]
+struct Unorm16x2 : AttributeFormat<glm::u16vec2, GL_UNSIGNED_SHORT, 2, true>
+{
+  static Storage pack(const glm::vec2& v)
+  {
+    return Storage(glm::round(glm::clamp(v, 0.0f, 1.0f) * 65535.0f));
+  }
+};
+
+struct Unorm8x4 : AttributeFormat<glm::u8vec4, GL_UNSIGNED_BYTE, 4, true>
+{
+  static Storage pack(const glm::vec4& v)
+  {
+    return Storage(glm::round(glm::clamp(v, 0.0f, 1.0f) * 255.0f));
+  }
+};
+
+// Three signed normalized 10-bit values and a 2-bit w, packed into a single 32-bit word
+struct Snorm10_10_10_2 : AttributeFormat<glm::uint32, GL_INT_2_10_10_10_REV, 4, true>
+{
+  static Storage pack(const glm::vec4& v)
+  {
+    const auto field = [](const float value, const int bits) {
+      return static_cast<glm::uint32>(encodeSnorm(value, bits)) & ((1u << bits) - 1);
+    };
+    return field(v.x, 10) | field(v.y, 10) << 10 | field(v.z, 10) << 20 | field(v.w, 2) << 30;
+  }
+};
+
+template <typename SemanticType, typename FormatType>
+struct Attr
+{
+  using Semantic = SemanticType;
+  using Format = FormatType;
+};
+
+template <typename MemberPointer>
+struct _MemberOf;
+
+template <typename Member, typename Class>
+struct _MemberOf<Member Class::*>
+{
+  using Type = Member;
+  using Owner = Class;
+};
+
+// Describes an interleaved vertex made of the given attributes, in order and tightly packed.
+// The stride and every offset are computed at compile time, e.g.
+//
+//   using TexturedLayout = VertexLayout<Attr<Position, Float3>, Attr<UV, Half2>>;
+//   static_assert(TexturedLayout::matches<TexturedVertex, &TexturedVertex::position, &TexturedVertex::uv>());
+template <typename... Attrs>
+struct VertexLayout
+{
+  static constexpr size_t attributeCount = sizeof...(Attrs);
+  static constexpr std::array<unsigned int, attributeCount> locations{Attrs::Semantic::location...};
+  static constexpr std::array<size_t, attributeCount> sizes{Attrs::Format::size...};
+  static constexpr unsigned int stride = (Attrs::Format::size + ... + 0);
+
+  static constexpr std::array<size_t, attributeCount> offsets = [] {
+    std::array<size_t, attributeCount> result{};
+    size_t offset = 0;
+    for (size_t i = 0; i < attributeCount; i++)
+    {
+      result[i] = offset;
+      offset += sizes[i];
+    }
+    return result;
+  }();
+
+  static_assert(attributeCount > 0, "A vertex layout needs at least one attribute");
+  static_assert([] {
+    for (size_t i = 0; i < attributeCount; i++)
+      for (size_t j = i + 1; j < attributeCount; j++)
+        if (locations[i] == locations[j])
+          return false;
+    return true;
+  }(), "Each attribute of a vertex layout must use a different semantic");
+
+  // Offset of the attribute with the given semantic, which the layout must have
+  template <typename Semantic>
+  static constexpr size_t offsetOf()
+  {
+    constexpr size_t index = [] {
+      constexpr std::array<bool, attributeCount> isSemantic{std::is_same_v<Semantic, typename Attrs::Semantic>...};
+      size_t i = 0;
+      while (i < attributeCount && !isSemantic[i])
+        i++;
+      return i;
+    }();
+    static_assert(index < attributeCount, "The vertex layout has no attribute with this semantic");
+    return offsets[index];
+  }
+
+  // True if Vertex can be uploaded as is: a plain struct whose size is exactly one stride. This is
+  // all the buffer upload can check; vertex structs should assert matches() on their members.
+  template <typename Vertex>
+  static constexpr bool fits()
+  {
+    return std::is_standard_layout_v<Vertex> && std::is_trivially_copyable_v<Vertex> && sizeof(Vertex) == stride;
+  }
+
+  // True if Vertex is exactly this layout. Members are pointers to its data members in the order
+  // of the attributes: each must be stored as its attribute's format, they must be declared in
+  // that order, and Vertex must fit() the stride. With no room left for padding or other members,
+  // that puts every member at its attribute's offset.
+  template <typename Vertex, auto... Members>
+  static constexpr bool matches()
+  {
+    static_assert(sizeof...(Members) == attributeCount, "Pass one member pointer per attribute, in layout order");
+    if constexpr (sizeof...(Members) != attributeCount)
+    {
+      return false;
+    }
+    else
+    {
+      static_assert((std::is_same_v<typename _MemberOf<decltype(Members)>::Owner, Vertex> && ...),
+                    "Member pointers must be to members of Vertex");
+      constexpr bool formats =
+        (std::is_same_v<typename _MemberOf<decltype(Members)>::Type, typename Attrs::Format::Storage> && ...);
+      if (!formats || !fits<Vertex>())
+        return false;
+
+      // Later declared members have higher addresses
+      constexpr Vertex vertex{};
+      const void* addresses[] = {&(vertex.*Members)...};
+      for (size_t i = 1; i < attributeCount; i++)
+      {
+        if (!(addresses[i - 1] < addresses[i]))
+          return false;
+      }
+      return true;
+    }
+  }
+
+  // Sets up every attribute for the buffer bound to GL_ARRAY_BUFFER
+  static void apply()
+  {
+    size_t i = 0;
+    (_applyAttribute<Attrs>(offsets[i++]), ...);
+  }
+
+private:
+  template <typename A>
+  static void _applyAttribute(const size_t offset)
+  {
+    using Format = typename A::Format;
+    constexpr unsigned int location = A::Semantic::location;
+    glVertexAttribPointer(location, Format::components, Format::type, Format::normalized ? GL_TRUE : GL_FALSE,
+                          stride, reinterpret_cast<void*>(offset));
+    glEnableVertexAttribArray(location);
+  }
+};
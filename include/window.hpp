@@ -2,6 +2,9 @@
 
 #include <iostream>
 
+#include "gl_extensions.hpp"
+#include "gl_state.hpp"
+
 #include "ext/glad/glad.h"
 #include "GLFW/glfw3.h"
 
@@ -11,7 +14,7 @@ constexpr int WINDOW_HEIGHT = 600;
 
 inline void framebuffer_size_callback(GLFWwindow *, const int width, const int height)
 {
-    glViewport(0, 0, width, height);
+    glState().viewport(0, 0, width, height);
 }
 
 inline void initWindow(GLFWwindow **window)
@@ -38,7 +41,8 @@ inline void initWindow(GLFWwindow **window)
         std::cout << "Failed to initialize GLAD" << std::endl;
         exit(-1);
     }
+    loadGLExtensions(reinterpret_cast<GLADloadproc>(glfwGetProcAddress));
 
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glState().viewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
     glfwSetFramebufferSizeCallback(*window, framebuffer_size_callback);
 }
\ No newline at end of file
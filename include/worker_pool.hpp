@@ -0,0 +1,121 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef unsigned int uint;
+
+// A fixed set of worker threads that sleep on a condition variable between jobs. run() splits a
+// job into tasks that the workers and the calling thread take one at a time, and returns once
+// they are all done. Work that is spread over threads every frame pays for a wake-up instead of
+// creating and joining threads every time.
+class WorkerPool
+{
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _wake, _done;
+  uint64_t _generation = 0; // Bumped for every job, workers compare it to the last one they ran
+  uint _busy = 0;           // Workers that haven't finished the current job yet
+  bool _stopping = false;
+
+  // The current job, set under _mutex before the workers are woken
+  void* _task = nullptr;
+  void (*_invoke)(void* task, size_t index, uint thread) = nullptr;
+  size_t _taskCount = 0;
+  std::atomic<size_t> _nextTask{0};
+
+  void _runTasks(const uint thread)
+  {
+    for (size_t index = _nextTask++; index < _taskCount; index = _nextTask++)
+    {
+      _invoke(_task, index, thread);
+    }
+  }
+
+  void _work(const uint thread)
+  {
+    uint64_t generation = 0;
+    while (true)
+    {
+      {
+        std::unique_lock lock(_mutex);
+        _wake.wait(lock, [&] { return _stopping || _generation != generation; });
+        if (_stopping)
+          return;
+        generation = _generation;
+      }
+
+      _runTasks(thread);
+
+      // Every worker checks in for every job, so none can still be looking at it once run() returns
+      std::lock_guard lock(_mutex);
+      if (--_busy == 0)
+        _done.notify_one();
+    }
+  }
+
+public:
+  // threadCount includes the thread calling run(), so a pool of 1 runs everything inline
+  explicit WorkerPool(const uint threadCount = std::max(1u, std::thread::hardware_concurrency()))
+  {
+    for (uint thread = 1; thread < std::max(1u, threadCount); thread++)
+    {
+      _threads.emplace_back(&WorkerPool::_work, this, thread);
+    }
+  }
+
+  ~WorkerPool()
+  {
+    {
+      std::lock_guard lock(_mutex);
+      _stopping = true;
+    }
+    _wake.notify_all();
+    for (std::thread& thread : _threads)
+    {
+      thread.join();
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  [[nodiscard]] uint threadCount() const { return static_cast<uint>(_threads.size()) + 1; }
+
+  // Calls task(index, thread) for every index in [0, taskCount) and returns when all calls are
+  // done. thread is in [0, threadCount()) and unique among the calls running at the same time,
+  // e.g. to pick per-thread output; the calling thread is 0. One job at a time, from one thread.
+  template <typename Task>
+  void run(const size_t taskCount, Task task)
+  {
+    if (_threads.empty() || taskCount <= 1)
+    {
+      for (size_t index = 0; index < taskCount; index++)
+      {
+        task(index, 0);
+      }
+      return;
+    }
+
+    {
+      std::lock_guard lock(_mutex);
+      _task = &task;
+      _invoke = [](void* job, const size_t index, const uint thread) { (*static_cast<Task*>(job))(index, thread); };
+      _taskCount = taskCount;
+      _nextTask.store(0, std::memory_order_relaxed);
+      _busy = static_cast<uint>(_threads.size());
+      _generation++;
+    }
+    _wake.notify_all();
+
+    _runTasks(0);
+
+    std::unique_lock lock(_mutex);
+    _done.wait(lock, [this] { return _busy == 0; });
+  }
+};
@@ -0,0 +1,113 @@
+// CPU-only benchmark of the block compression encoder. Every getting-started texture is encoded
+// with the scalar reference, the SIMD encoder on one thread and the SIMD encoder on all threads.
+// Encode throughput is reported in MPix/s, and the error of the decoded result as PSNR.
+//
+// Usage: block_compression_benchmark [texture dir]
+// The texture directory defaults to `textures`, i.e. run it from src/getting-started.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "block_compression.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "ext/stb_image.h"
+
+constexpr int RUNS = 20;
+
+struct Case
+{
+    const char* texture;
+    BlockFormat format;
+    int channels; // Channels the format keeps, the PSNR is measured over these
+};
+
+const Case CASES[] = {
+    {"container.jpg", BlockFormat::BC1, 3},
+    {"wall.jpg", BlockFormat::BC1, 3},
+    {"awesome_face.png", BlockFormat::BC3, 4},
+    {"container.jpg", BlockFormat::BC4, 1},
+    {"container.jpg", BlockFormat::BC5, 2},
+};
+
+const char* formatName(const BlockFormat format)
+{
+    switch (format)
+    {
+        case BlockFormat::BC1: return "BC1";
+        case BlockFormat::BC3: return "BC3";
+        case BlockFormat::BC4: return "BC4";
+        default: return "BC5";
+    }
+}
+
+// Best of RUNS, in megapixels per second
+template <typename Encode>
+double throughput(const int pixels, Encode encode)
+{
+    double best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        encode();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return pixels / best / 1e6;
+}
+
+double psnr(const unsigned char* source, const int sourceChannels, const std::vector<unsigned char>& decoded,
+            const int pixels, const int channels)
+{
+    double squaredError = 0.0;
+    for (int i = 0; i < pixels; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            const double difference = source[i * sourceChannels + c] - decoded[i * 4 + c];
+            squaredError += difference * difference;
+        }
+    }
+    const double mse = squaredError / (static_cast<double>(pixels) * channels);
+    return mse == 0.0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+int main(const int argc, char** argv)
+{
+    const std::string directory = argc > 1 ? argv[1] : "textures";
+    const uint threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Case& test : CASES)
+    {
+        int width, height, channels;
+        unsigned char* pixels = stbi_load((directory + "/" + test.texture).c_str(), &width, &height, &channels, 0);
+        if (pixels == nullptr)
+        {
+            std::cout << "Failed to load texture at: " << directory << "/" << test.texture << std::endl;
+            return 1;
+        }
+
+        CompressedImage scalar{}, simd{};
+        const double scalarRate = throughput(width * height, [&] {
+            scalar = compressImage(pixels, width, height, channels, test.format, 1, encodeBlockScalar);
+        });
+        const double simdRate = throughput(width * height, [&] {
+            simd = compressImage(pixels, width, height, channels, test.format, 1);
+        });
+        const double threadedRate = throughput(width * height, [&] {
+            simd = compressImage(pixels, width, height, channels, test.format, threads);
+        });
+
+        std::cout << test.texture << " " << formatName(test.format) << " (" << width << "x" << height << "): "
+                  << scalarRate << " MPix/s scalar, " << simdRate << " MPix/s SIMD, " << threadedRate << " MPix/s on "
+                  << threads << " threads, PSNR " << std::setprecision(2)
+                  << psnr(pixels, channels, decompressImage(simd), width * height, test.channels) << " dB"
+                  << (scalar.blocks == simd.blocks ? "" : " (scalar output differs)") << std::setprecision(1) << "\n";
+        stbi_image_free(pixels);
+    }
+    return 0;
+}
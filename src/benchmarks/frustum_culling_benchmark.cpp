@@ -0,0 +1,94 @@
+// CPU-only benchmark of batched frustum culling. One million random bounding spheres and boxes are
+// culled against a perspective camera with the scalar reference, every SIMD path the CPU supports
+// and the best path spread over all hardware threads. Correctness is checked by
+// frustum_culling_test, not here.
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frustum.hpp"
+
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/matrix_transform.hpp"
+
+constexpr size_t OBJECT_COUNT = 1000000;
+constexpr int RUNS = 50;
+
+// Best of RUNS, in milliseconds
+template <typename Cull>
+double timeCulling(Cull cull)
+{
+    double best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        cull();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void report(const char* name, const char* path, const size_t count, const double ms, const double scalarMs)
+{
+    std::cout << "  " << std::left << std::setw(8) << name << std::setw(22) << path << std::right << std::fixed
+              << std::setprecision(3) << std::setw(7) << ms << " ms, " << std::setprecision(1) << std::setw(5)
+              << scalarMs / ms << "x, " << count << "/" << OBJECT_COUNT << " visible\n";
+}
+
+template <typename Cull, typename CullScalar, typename CullParallel>
+void benchmark(const char* name, Cull cull, CullScalar cullScalar, CullParallel cullParallel, WorkerPool& pool)
+{
+    std::vector<uint> visible;
+    size_t count = 0;
+    const double scalarMs = timeCulling([&] { count = cullScalar(visible); });
+    report(name, "scalar", count, scalarMs, scalarMs);
+    for (const CullingPath path : {CullingPath::SSE2, CullingPath::AVX2, CullingPath::AVX512})
+    {
+        if (!cullingPathSupported(path))
+            continue;
+        const double ms = timeCulling([&] { count = cull(visible, path); });
+        report(name, cullingPathName(path), count, ms, scalarMs);
+    }
+
+    const std::string parallel = std::string(cullingPathName(cullingPath())) + " on " +
+                                 std::to_string(pool.threadCount()) + " thread" + (pool.threadCount() == 1 ? "" : "s");
+    const double ms = timeCulling([&] { count = cullParallel(visible); });
+    report(name, parallel.c_str(), count, ms, scalarMs);
+}
+
+int main()
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution position(-100.0f, 100.0f);
+    std::uniform_real_distribution size(0.1f, 2.0f);
+
+    BoundingSpheres spheres;
+    BoundingBoxes boxes;
+    for (size_t i = 0; i < OBJECT_COUNT; i++)
+    {
+        const glm::vec3 centre(position(random), position(random), position(random));
+        spheres.add(centre, size(random));
+        boxes.add(centre, glm::vec3(size(random), size(random), size(random)));
+    }
+
+    const glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const Frustum frustum = Frustum::fromMatrix(projection * view);
+    WorkerPool pool;
+
+    benchmark(
+        "Spheres",
+        [&](std::vector<uint>& visible, const CullingPath path) { return cullSpheres(frustum, spheres, visible, path); },
+        [&](std::vector<uint>& visible) { return cullSpheresScalar(frustum, spheres, visible); },
+        [&](std::vector<uint>& visible) { return cullSpheres(frustum, spheres, visible, pool); }, pool);
+    benchmark(
+        "Boxes",
+        [&](std::vector<uint>& visible, const CullingPath path) { return cullBoxes(frustum, boxes, visible, path); },
+        [&](std::vector<uint>& visible) { return cullBoxesScalar(frustum, boxes, visible); },
+        [&](std::vector<uint>& visible) { return cullBoxes(frustum, boxes, visible, pool); }, pool);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// CPU-only benchmark of reduced resolution JPEG decoding. Each JPEG of the getting-started
+// textures is decoded at 1/2, 1/4 and 1/8 scale with the DCT-domain scaling decoder, and compared
+// with a full stb_image decode followed by box filtering down to the same size. Reports the time
+// of both paths and the PSNR of the scaled decode against the filtered one. The files are read
+// into memory first, so only decoding is timed.
+//
+// Usage: jpeg_scaled_decode_benchmark [texture dir]
+// The texture directory defaults to `textures`, i.e. run it from src/getting-started.
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "jpeg_decoder.hpp"
+#include "mipmap_generator.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "ext/stb_image.h"
+
+const char* TEXTURES[] = {"container.jpg", "wall.jpg"};
+constexpr int SCALES[] = {2, 4, 8};
+constexpr int RUNS = 20;
+
+// Best of RUNS, in milliseconds
+template <typename Decode>
+double timeDecode(Decode decode)
+{
+    double best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        decode();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+// stb_image at full size, then 2x2 box filtered down once per halving. The filter works on the
+// encoded values like the scaled IDCT does, so the two are comparable.
+MipLevel decodeAndDownsample(const std::vector<unsigned char>& file, const int scale)
+{
+    int width, height, channels;
+    unsigned char* pixels = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &channels, 0);
+    MipLevel level{width, height, std::vector<unsigned char>(pixels, pixels + static_cast<size_t>(width) * height * channels)};
+    stbi_image_free(pixels);
+    for (int s = scale; s > 1; s /= 2)
+    {
+        level = downsample(level.pixels.data(), level.width, level.height, channels);
+    }
+    return level;
+}
+
+double psnr(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    double squaredError = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        const double difference = static_cast<double>(a[i]) - b[i];
+        squaredError += difference * difference;
+    }
+    if (squaredError == 0.0)
+        return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 / (squaredError / static_cast<double>(a.size())));
+}
+
+int main(const int argc, char** argv)
+{
+    const std::string directory = argc > 1 ? argv[1] : "textures";
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const char* texture : TEXTURES)
+    {
+        const std::string path = directory + "/" + texture;
+        std::ifstream stream(path, std::ios::binary);
+        const std::vector<unsigned char> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+        JpegImage full;
+        if (file.empty() || !decodeJpeg(file.data(), file.size(), 1, &full))
+        {
+            std::cout << "Failed to decode " << path << "\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << texture << " (" << full.width << "x" << full.height << ")\n";
+        const double stbMs = timeDecode([&] { decodeAndDownsample(file, 1); });
+        const double fullMs = timeDecode([&] { decodeJpeg(file.data(), file.size(), 1, &full); });
+        std::cout << "  1/1: stb_image " << stbMs << " ms, scaling decoder " << fullMs << " ms, PSNR "
+                  << psnr(full.pixels, decodeAndDownsample(file, 1).pixels) << " dB\n";
+
+        for (const int scale : SCALES)
+        {
+            JpegImage scaled;
+            const double downsampleMs = timeDecode([&] { decodeAndDownsample(file, scale); });
+            const double scaledMs = timeDecode([&] { decodeJpeg(file.data(), file.size(), scale, &scaled); });
+
+            const MipLevel reference = decodeAndDownsample(file, scale);
+            if (reference.width != scaled.width || reference.height != scaled.height)
+            {
+                std::cout << "  1/" << scale << ": size mismatch, " << scaled.width << "x" << scaled.height << " instead of "
+                          << reference.width << "x" << reference.height << "\n";
+                return EXIT_FAILURE;
+            }
+            std::cout << "  1/" << scale << ": decode + downsample " << downsampleMs << " ms, scaled decode " << scaledMs
+                      << " ms (" << downsampleMs / scaledMs << "x), PSNR " << psnr(scaled.pixels, reference.pixels) << " dB\n";
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+// CPU-only benchmark of the mesh optimisation stages. Large generated meshes have their triangles
+// shuffled to simulate an unoptimised export, then every stage is applied and measured.
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "mesh_optimizer.hpp"
+
+#include "ext/glm/glm.hpp"
+
+// Flat grid of `size` x `size` quads
+FloatMesh generateGrid(const uint size)
+{
+    FloatMesh mesh;
+    for (uint y = 0; y <= size; y++)
+    {
+        for (uint x = 0; x <= size; x++)
+        {
+            mesh.positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f);
+        }
+    }
+    for (uint y = 0; y < size; y++)
+    {
+        for (uint x = 0; x < size; x++)
+        {
+            const uint topLeft = y * (size + 1) + x;
+            const uint bottomLeft = topLeft + size + 1;
+            mesh.indices.insert(mesh.indices.end(), {topLeft, bottomLeft, topLeft + 1});
+            mesh.indices.insert(mesh.indices.end(), {topLeft + 1, bottomLeft, bottomLeft + 1});
+        }
+    }
+    return mesh;
+}
+
+// Many overlapping spheres merged into one mesh, so that triangle order affects overdraw
+FloatMesh generateSphereCluster(const uint count, std::mt19937& random)
+{
+    std::uniform_real_distribution offset(-2.0f, 2.0f);
+    const FloatMesh sphere = generateSphere(64, 32);
+
+    FloatMesh mesh;
+    for (uint i = 0; i < count; i++)
+    {
+        const auto baseVertex = static_cast<uint>(mesh.positions.size());
+        const glm::vec3 centre(offset(random), offset(random), offset(random));
+        for (const glm::vec3& position : sphere.positions)
+        {
+            mesh.positions.push_back(position + centre);
+        }
+        for (const uint index : sphere.indices)
+        {
+            mesh.indices.push_back(index + baseVertex);
+        }
+    }
+    return mesh;
+}
+
+void shuffleTriangles(std::vector<uint>& indices, std::mt19937& random)
+{
+    const size_t triangleCount = indices.size() / 3;
+    for (size_t i = triangleCount - 1; i > 0; i--)
+    {
+        const size_t j = std::uniform_int_distribution<size_t>(0, i)(random);
+        for (int k = 0; k < 3; k++)
+        {
+            std::swap(indices[i * 3 + k], indices[j * 3 + k]);
+        }
+    }
+}
+
+void report(const std::string& stage, const FloatMesh& mesh, const double milliseconds)
+{
+    const auto vertexCount = static_cast<uint>(mesh.positions.size());
+    const VertexCacheStats stats = analyzeVertexCache(mesh.indices, vertexCount);
+    std::cout << "  " << std::left << std::setw(14) << stage << std::right << std::fixed << std::setprecision(3)
+              << "ACMR " << std::setw(6) << stats.acmr << "   ATVR " << std::setw(6) << stats.atvr
+              << "   overdraw " << std::setw(6) << analyzeOverdraw(mesh.indices, mesh.positions)
+              << "   " << std::setprecision(1) << std::setw(8) << milliseconds << " ms\n";
+}
+
+template <typename Stage>
+double timeStage(Stage stage)
+{
+    const auto start = std::chrono::steady_clock::now();
+    stage();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void benchmark(const std::string& name, FloatMesh mesh, std::mt19937& random)
+{
+    std::cout << name << ": " << mesh.positions.size() << " vertices, " << mesh.indices.size() / 3 << " triangles\n";
+    shuffleTriangles(mesh.indices, random);
+    report("shuffled", mesh, 0.0);
+
+    const auto vertexCount = static_cast<uint>(mesh.positions.size());
+    double ms = timeStage([&] { mesh.indices = optimizeVertexCache(mesh.indices, vertexCount); });
+    report("vertex cache", mesh, ms);
+
+    ms = timeStage([&] { mesh.indices = optimizeOverdraw(mesh.indices, mesh.positions); });
+    report("overdraw", mesh, ms);
+
+    ms = timeStage([&] { optimizeVertexFetch(mesh.positions, mesh.indices); });
+    report("vertex fetch", mesh, ms);
+}
+
+int main()
+{
+    std::mt19937 random(42);
+    benchmark("Sphere 512x256", generateSphere(512, 256), random);
+    benchmark("Grid 512x512", generateGrid(512), random);
+    benchmark("64 sphere cluster", generateSphereCluster(64, random), random);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// CPU-only benchmark of mip chain generation. A 4096x4096 test image is reduced to 1x1 with the
+// scalar reference and the SIMD generator on one and on all threads, for RGB8, RGBA8 and sRGB,
+// with the box and the Kaiser filter. Reports the time per chain and the largest difference
+// between the SIMD and scalar results.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "mipmap_generator.hpp"
+
+constexpr int SIZE = 4096;
+constexpr int RUNS = 3;
+
+struct Case
+{
+    const char* name;
+    int channels;
+    bool srgb;
+    MipFilter filter;
+};
+
+const Case CASES[] = {
+    {"RGB8 box", 3, false, MipFilter::Box},
+    {"RGBA8 box", 4, false, MipFilter::Box},
+    {"sRGB8 box", 3, true, MipFilter::Box},
+    {"sRGBA8 box", 4, true, MipFilter::Box},
+    {"RGBA8 Kaiser", 4, false, MipFilter::Kaiser},
+    {"sRGBA8 Kaiser", 4, true, MipFilter::Kaiser},
+};
+
+// Same chain as generateMipLevels, with the scalar reference
+std::vector<MipLevel> generateMipLevelsScalar(const unsigned char* pixels, int width, int height, const int channels,
+                                              const MipOptions& options)
+{
+    std::vector<MipLevel> levels;
+    while (width > 1 || height > 1)
+    {
+        levels.push_back(downsampleScalar(pixels, width, height, channels, options));
+        pixels = levels.back().pixels.data();
+        width = levels.back().width;
+        height = levels.back().height;
+    }
+    return levels;
+}
+
+// Best of RUNS, in milliseconds
+template <typename Generate>
+double timeGeneration(Generate generate)
+{
+    double best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        generate();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+int maxDifference(const std::vector<MipLevel>& a, const std::vector<MipLevel>& b)
+{
+    int difference = 0;
+    for (size_t level = 0; level < a.size(); level++)
+    {
+        for (size_t i = 0; i < a[level].pixels.size(); i++)
+            difference = std::max(difference, std::abs(a[level].pixels[i] - b[level].pixels[i]));
+    }
+    return difference;
+}
+
+int main()
+{
+    const uint threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Smooth gradients with noise on top, so neither filter sees a flat image
+    std::mt19937 random(42);
+    std::uniform_int_distribution noise(-24, 24);
+    std::vector<unsigned char> image(static_cast<size_t>(SIZE) * SIZE * 4);
+    for (int y = 0; y < SIZE; y++)
+    {
+        for (int x = 0; x < SIZE; x++)
+        {
+            unsigned char* pixel = &image[(static_cast<size_t>(y) * SIZE + x) * 4];
+            pixel[0] = std::clamp(x * 255 / SIZE + noise(random), 0, 255);
+            pixel[1] = std::clamp(y * 255 / SIZE + noise(random), 0, 255);
+            pixel[2] = std::clamp((x ^ y) & 255, 0, 255);
+            pixel[3] = std::clamp(128 + noise(random) * 4, 0, 255);
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    for (const Case& test : CASES)
+    {
+        // RGB cases read the same buffer as tightly packed 3 byte pixels
+        MipOptions options{test.filter, test.srgb, 1};
+        std::vector<MipLevel> scalar, simd;
+        const double scalarMs = timeGeneration([&] {
+            scalar = generateMipLevelsScalar(image.data(), SIZE, SIZE, test.channels, options);
+        });
+        const double simdMs = timeGeneration([&] {
+            simd = generateMipLevels(image.data(), SIZE, SIZE, test.channels, options);
+        });
+        options.threadCount = threads;
+        const double threadedMs = timeGeneration([&] {
+            simd = generateMipLevels(image.data(), SIZE, SIZE, test.channels, options);
+        });
+
+        std::cout << test.name << ": " << scalarMs << " ms scalar, " << simdMs << " ms SIMD (" << MIP_LANES
+                  << " lanes, " << scalarMs / simdMs << "x), " << threadedMs << " ms on " << threads
+                  << " threads, max difference " << maxDifference(scalar, simd) << "\n";
+    }
+    return 0;
+}
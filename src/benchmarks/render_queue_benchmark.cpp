@@ -0,0 +1,174 @@
+// CPU-only benchmark of the sort-key render queue. For 10k to 1M objects with random programs,
+// materials and positions, packets (model matrix + sort key) are recorded on 1 to N threads,
+// radix sorted and submitted to a backend that only counts state changes. Reports the time of
+// each stage, the draws per second of the whole frame and the state changes saved by sorting,
+// and checks the radix sort against std::stable_sort. Exits with 1 if they differ.
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "render_queue.hpp"
+
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/matrix_transform.hpp"
+
+constexpr size_t OBJECT_COUNTS[] = {10000, 100000, 1000000};
+constexpr uint PROGRAM_COUNT = 8;
+constexpr uint MATERIAL_COUNT = 64;
+constexpr float TRANSPARENT_FRACTION = 0.1f;
+constexpr int RUNS = 10;
+
+// Keeps the submitted draws from being optimised away
+volatile float checksumSink;
+
+// Best of RUNS, in milliseconds
+template <typename Work>
+double timeWork(Work work)
+{
+    double best = 1e9;
+    for (int run = 0; run < RUNS; run++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        work();
+        best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+struct SceneObject
+{
+    glm::vec3 position;
+    float angle;
+    uint layer; // 0 opaque, 1 transparent
+    uint program;
+    uint material;
+};
+
+// Stands in for the GL thread: counts state changes and touches the draw data like a uniform upload would
+struct CountingBackend
+{
+    float checksum = 0.0f;
+
+    void bindLayer(uint) {}
+    void bindProgram(uint) {}
+    void bindMaterial(uint) {}
+    void draw(const DrawPacket& packet) { checksum += (*static_cast<const glm::mat4*>(packet.data))[3][0]; }
+};
+
+// Program and material changes when drawing in recording order
+RenderQueueStats unsortedChanges(const std::vector<SceneObject>& objects)
+{
+    RenderQueueStats stats;
+    for (size_t i = 0; i < objects.size(); i++)
+    {
+        const bool programChanged = i == 0 || objects[i].program != objects[i - 1].program;
+        stats.programChanges += programChanged;
+        stats.materialChanges += programChanged || objects[i].material != objects[i - 1].material;
+    }
+    return stats;
+}
+
+bool benchmark(const size_t objectCount, const std::vector<uint>& threadCounts)
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution position(-100.0f, 100.0f);
+    std::uniform_real_distribution unit(0.0f, 1.0f);
+    std::uniform_int_distribution<uint> program(0, PROGRAM_COUNT - 1);
+    std::uniform_int_distribution<uint> material(0, MATERIAL_COUNT - 1);
+
+    std::vector<SceneObject> objects(objectCount);
+    for (SceneObject& object : objects)
+    {
+        object = {glm::vec3(position(random), position(random), position(random)), unit(random) * 6.28f,
+                  unit(random) < TRANSPARENT_FRACTION ? 1u : 0u, program(random), material(random)};
+    }
+    const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 150.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    std::vector<glm::mat4> models(objectCount);
+
+    const auto sortKey = [&](const size_t i) {
+        const SceneObject& object = objects[i];
+        const float distance = -(view * models[i][3]).z;
+        return makeSortKey(object.layer, object.program, object.material, sortKeyDepth(distance, object.layer == 1));
+    };
+
+    // What a frame does per object: animate it, work out its distance and record the draw
+    const auto record = [&](DrawRecorder& recorder, const size_t begin, const size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            const SceneObject& object = objects[i];
+            models[i] = glm::rotate(glm::translate(glm::mat4(1.0f), object.position), object.angle,
+                                    glm::vec3(0.5f, 1.0f, 0.0f));
+            recorder.push(sortKey(i), &models[i]);
+        }
+    };
+
+    std::cout << objectCount << " objects\n";
+    std::cout << std::fixed << std::setprecision(2);
+    double bestRecordMs = 1e9;
+    for (const uint threads : threadCounts)
+    {
+        RenderQueue queue(threads);
+        const double recordMs = timeWork([&] {
+            queue.clear();
+            queue.record(objectCount, record);
+        });
+        bestRecordMs = std::min(bestRecordMs, recordMs);
+        std::cout << "  record on " << threads << " thread" << (threads == 1 ? ": " : "s: ") << recordMs << " ms\n";
+    }
+
+    // Recorded on one thread the packets are in object order, which std::stable_sort can start from
+    // too. The radix sort is stable, so both have to come out the same.
+    RenderQueue queue(1);
+    queue.record(objectCount, record);
+    const double sortMs = timeWork([&] { queue.sort(); });
+
+    std::vector<DrawPacket> recorded, reference;
+    for (size_t i = 0; i < objectCount; i++)
+    {
+        recorded.push_back({sortKey(i), &models[i]});
+    }
+    const double referenceMs = timeWork([&] {
+        reference = recorded;
+        std::stable_sort(reference.begin(), reference.end(),
+                         [](const DrawPacket& a, const DrawPacket& b) { return a.key < b.key; });
+    });
+    const bool match = std::equal(reference.begin(), reference.end(), queue.packets().begin(),
+                                  [](const DrawPacket& a, const DrawPacket& b) { return a.key == b.key && a.data == b.data; });
+
+    CountingBackend backend;
+    RenderQueueStats stats;
+    const double submitMs = timeWork([&] { stats = queue.submit(backend); });
+    checksumSink = backend.checksum;
+
+    const double frameMs = bestRecordMs + sortMs + submitMs;
+    const RenderQueueStats unsorted = unsortedChanges(objects);
+    std::cout << "  radix sort: " << sortMs << " ms (std::stable_sort " << referenceMs << " ms)"
+              << (match ? "" : " MISMATCH") << "\n"
+              << "  submit: " << submitMs << " ms\n"
+              << "  " << static_cast<double>(objectCount) / frameMs / 1000.0 << "M draws/s recorded, sorted and submitted\n"
+              << "  program changes " << stats.programChanges << " (unsorted " << unsorted.programChanges
+              << "), material changes " << stats.materialChanges << " (unsorted " << unsorted.materialChanges << ")\n";
+    return match;
+}
+
+int main()
+{
+    const uint hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<uint> threadCounts;
+    for (uint threads = 1; threads < hardwareThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(hardwareThreads);
+
+    bool match = true;
+    for (const size_t objectCount : OBJECT_COUNTS)
+    {
+        match &= benchmark(objectCount, threadCounts);
+    }
+    return match ? 0 : 1;
+}
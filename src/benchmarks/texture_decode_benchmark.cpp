@@ -0,0 +1,73 @@
+// CPU-only benchmark of background image decoding. Decodes N copies of each of the getting-started
+// textures with 1..T worker threads and reports the wall-clock time until the last image is back.
+//
+// Usage: texture_decode_benchmark [copies = 32] [max threads = hardware threads] [texture dir]
+// The texture directory defaults to `textures`, i.e. run it from src/getting-started.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "image_decoder.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "ext/stb_image.h"
+
+const char* TEXTURES[] = {"container.jpg", "wall.jpg", "awesome_face.png"};
+
+int main(const int argc, char** argv)
+{
+    const int copies = argc > 1 ? std::atoi(argv[1]) : 32;
+    const uint maxThreads = argc > 2 ? std::atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    const std::string directory = argc > 3 ? argv[3] : "textures";
+    const size_t imageCount = copies * std::size(TEXTURES);
+
+    std::cout << "Decoding " << imageCount << " images\n";
+    double singleThreadMs = 0.0;
+    for (uint threads = 1; threads <= maxThreads; threads++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        size_t failed = 0;
+        {
+            ImageDecoder decoder(threads);
+            for (int copy = 0; copy < copies; copy++)
+            {
+                for (const char* texture : TEXTURES)
+                {
+                    decoder.submit(copy, directory + "/" + texture);
+                }
+            }
+
+            size_t received = 0;
+            DecodedImage image;
+            while (received < imageCount)
+            {
+                if (!decoder.tryGetResult(image))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                failed += image.pixels == nullptr;
+                stbi_image_free(image.pixels);
+                received++;
+            }
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        if (failed > 0)
+        {
+            std::cout << "Failed to decode " << failed << " images, is the texture directory right?\n";
+            return 1;
+        }
+
+        if (threads == 1)
+            singleThreadMs = ms;
+        std::cout << std::setw(3) << threads << " threads: " << std::fixed << std::setprecision(1) << std::setw(8) << ms
+                  << " ms, " << std::setw(7) << imageCount * 1000.0 / ms << " images/s, "
+                  << std::setprecision(2) << singleThreadMs / ms << "x\n";
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// CPU-only benchmark of texture packing. A scene with 1000 materials of mixed sizes is packed into
+// texture arrays and atlases, and the texture binds per frame are counted for drawing every
+// material once with one texture per material versus with the packed arrays. The binds are
+// counted from the plan; no textures are created.
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "texture_packer.hpp"
+
+constexpr size_t MATERIAL_COUNT = 1000;
+
+int main()
+{
+    // Mostly power of two sizes shared by many materials, plus a tail of odd sized decals and UI
+    std::mt19937 random(42);
+    std::uniform_int_distribution odd(16, 400);
+    std::vector<TextureDesc> materials;
+    for (size_t i = 0; i < MATERIAL_COUNT; i++)
+    {
+        const size_t kind = i % 10;
+        if (kind < 5)
+            materials.push_back({512, 512, 4});
+        else if (kind < 7)
+            materials.push_back({1024, 1024, 4});
+        else if (kind < 8)
+            materials.push_back({256, 256, 1});
+        else
+            materials.push_back({odd(random), odd(random), kind == 8 ? 4 : 1});
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const TexturePackOptions options;
+    const TexturePackPlan plan = planTexturePacking(materials, options);
+    const double planMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << MATERIAL_COUNT << " materials packed into " << plan.arrays.size() << " texture arrays in " << planMs
+              << " ms:\n";
+    for (size_t i = 0; i < plan.arrays.size(); i++)
+    {
+        const PackedArray& array = plan.arrays[i];
+        std::cout << "  " << array.width << "x" << array.height << "x" << array.layers << ", " << array.channels
+                  << " channels" << (array.atlas ? ", atlas pages" : "") << "\n";
+    }
+
+    // Fill the atlas pages with placeholder pixels to check the gutters stay inside the layers
+    size_t gutterPixels = 0;
+    for (uint arrayIndex = 0; arrayIndex < plan.arrays.size(); arrayIndex++)
+    {
+        const PackedArray& array = plan.arrays[arrayIndex];
+        if (!array.atlas)
+            continue;
+        std::vector<std::vector<unsigned char>> layers(array.layers, std::vector<unsigned char>(
+            static_cast<size_t>(array.width) * array.height * array.channels));
+        for (size_t i = 0; i < materials.size(); i++)
+        {
+            const TexturePlacement& placement = plan.placements[i];
+            if (placement.array != arrayIndex)
+                continue;
+            const std::vector<unsigned char> pixels(static_cast<size_t>(materials[i].width) * materials[i].height *
+                                                    materials[i].channels, static_cast<unsigned char>(i));
+            blitWithGutter(pixels.data(), placement, array.channels, options.gutter, layers[placement.layer].data(),
+                           array.width, array.height);
+            gutterPixels += static_cast<size_t>(materials[i].width + 2 * options.gutter) *
+                            (materials[i].height + 2 * options.gutter) - materials[i].width * materials[i].height;
+        }
+    }
+    std::cout << "Atlas gutters: " << gutterPixels << " pixels\n";
+
+    // Draws are sorted by texture, so a bind is only needed when the texture changes
+    std::vector<size_t> order(MATERIAL_COUNT);
+    for (size_t i = 0; i < MATERIAL_COUNT; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        return plan.placements[a].array < plan.placements[b].array;
+    });
+    size_t packedBinds = 0;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (i == 0 || plan.placements[order[i]].array != plan.placements[order[i - 1]].array)
+            packedBinds++;
+    }
+
+    std::cout << "Texture binds per frame: " << MATERIAL_COUNT << " with one texture per material, " << packedBinds
+              << " with texture arrays (the layer and UV transform become per-draw uniforms)\n";
+    return 0;
+}
@@ -0,0 +1,229 @@
+// CPU-only benchmark of the redundant uniform upload cache. Replays the uniform uploads of the
+// demos' frames against programs whose driver side is faked, once with the cache skipping
+// unchanged values and once sending every set* call through, as `lighting --no-uniform-cache`
+// does. Reports the driver calls per frame of both and the CPU time per set call, which is the cost
+// of the cache checks plus a copy standing in for the driver. Checks after every frame that the
+// fake driver holds the last value set to every uniform, exits with 1 if it doesn't.
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "uniform_cache.hpp"
+
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/matrix_transform.hpp"
+#include "ext/glm/gtc/type_ptr.hpp"
+
+constexpr int RUNS = 5;
+
+// Stands in for a linked program: a UniformCache in front of the values the driver holds
+struct FakeProgram
+{
+    UniformCache cache;
+    std::vector<std::array<float, 16>> driverValues;
+    std::vector<std::array<float, 16>> setValues;
+    uint64_t setCalls = 0;
+    uint64_t driverCalls = 0;
+
+    explicit FakeProgram(const size_t uniformCount)
+        : cache(uniformCount), driverValues(uniformCount), setValues(uniformCount)
+    {
+    }
+
+    void set(const uint uniform, const float* value, const size_t floatCount)
+    {
+        const size_t size = floatCount * sizeof(float);
+        std::memcpy(setValues[uniform].data(), value, size);
+        setCalls++;
+        if (cache.update(uniform, value, size))
+        {
+            std::memcpy(driverValues[uniform].data(), value, size);
+            driverCalls++;
+        }
+    }
+
+    [[nodiscard]] bool consistent() const { return driverValues == setValues; }
+};
+
+// One set* call of a frame, recorded ahead so that building the values isn't timed
+struct UniformSet
+{
+    uint program;
+    uint uniform;
+    uint floatCount;
+    std::array<float, 16> value;
+};
+
+class FrameRecorder
+{
+    std::vector<UniformSet>& _calls;
+
+public:
+    explicit FrameRecorder(std::vector<UniformSet>& calls) : _calls(calls) {}
+
+    void set(const uint program, const uint uniform, const float* value, const uint floatCount)
+    {
+        UniformSet& call = _calls.emplace_back(UniformSet{program, uniform, floatCount, {}});
+        std::copy_n(value, floatCount, call.value.begin());
+    }
+};
+
+struct Scenario
+{
+    const char* name;
+    std::vector<size_t> uniformCounts; // Per program
+    int frames;
+    std::function<void(FrameRecorder& recorder, int frame)> frame;
+};
+
+glm::mat4 rotatingModel(const glm::vec3& position, const int index, const float time)
+{
+    const float angle = 20.0f * static_cast<float>(index % 10 + 1);
+    return glm::rotate(glm::translate(glm::mat4(1.0f), position), time * glm::radians(angle), glm::vec3(0.5f, 1.0f, 0.0f));
+}
+
+std::vector<Scenario> scenarios()
+{
+    const glm::vec3 objectColour(1.0f, 0.5f, 0.31f), lightColour(1.0f);
+    const glm::mat4 cubeModel(1.0f);
+    const glm::mat4 lightModel = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(1.2f, 1.0f, 2.0f)), glm::vec3(0.2f));
+
+    return {
+        // lighting: two colours and a model for the cube, a model for the light, none of them animated
+        {"lighting", {3, 1}, 10000, [=](FrameRecorder& recorder, int) {
+             recorder.set(0, 0, glm::value_ptr(objectColour), 3);
+             recorder.set(0, 1, glm::value_ptr(lightColour), 3);
+             recorder.set(0, 2, glm::value_ptr(cubeModel), 16);
+             recorder.set(1, 0, glm::value_ptr(lightModel), 16);
+         }},
+        // getting_started: ten rotating cubes through one model uniform
+        {"getting_started", {1}, 10000, [](FrameRecorder& recorder, const int frame) {
+             for (int i = 0; i < 10; i++)
+             {
+                 const glm::mat4 model = rotatingModel(glm::vec3(static_cast<float>(i)), i, static_cast<float>(frame) / 60.0f);
+                 recorder.set(0, 0, glm::value_ptr(model), 16);
+             }
+         }},
+        // A frame sorted by material: every draw has its own model, the colour and shininess only
+        // change between the 64 materials of 10k draws
+        {"10k draws sorted by material", {3}, 100, [](FrameRecorder& recorder, const int frame) {
+             constexpr int DRAWS = 10000;
+             constexpr int MATERIALS = 64;
+             for (int i = 0; i < DRAWS; i++)
+             {
+                 const int material = i * MATERIALS / DRAWS;
+                 const glm::vec3 colour(static_cast<float>(material) / MATERIALS, 0.5f, 0.5f);
+                 const float shininess = 32.0f;
+                 const glm::mat4 model = rotatingModel(glm::vec3(static_cast<float>(i)), i, static_cast<float>(frame) / 60.0f);
+                 recorder.set(0, 0, glm::value_ptr(model), 16);
+                 recorder.set(0, 1, glm::value_ptr(colour), 3);
+                 recorder.set(0, 2, &shininess, 1);
+             }
+         }},
+        // getting_started --stress --naive: a different model for each of 100k cubes, nothing to skip
+        {"100k naive stress draws", {1}, 10, [](FrameRecorder& recorder, const int frame) {
+             for (int i = 0; i < 100000; i++)
+             {
+                 const glm::mat4 model = rotatingModel(glm::vec3(static_cast<float>(i)), i, static_cast<float>(frame) / 60.0f);
+                 recorder.set(0, 0, glm::value_ptr(model), 16);
+             }
+         }},
+    };
+}
+
+struct RunResult
+{
+    double setCallsPerFrame = 0.0;
+    double driverCallsPerFrame = 0.0;
+    double nsPerSetCall = 1e9; // Best of RUNS
+    bool consistent = true;
+};
+
+std::vector<FakeProgram> makePrograms(const Scenario& scenario)
+{
+    std::vector<FakeProgram> programs;
+    for (const size_t uniformCount : scenario.uniformCounts)
+    {
+        programs.emplace_back(uniformCount);
+    }
+    return programs;
+}
+
+void replay(std::vector<FakeProgram>& programs, const std::vector<UniformSet>& calls)
+{
+    for (const UniformSet& call : calls)
+    {
+        programs[call.program].set(call.uniform, call.value.data(), call.floatCount);
+    }
+}
+
+RunResult run(const Scenario& scenario, const std::vector<std::vector<UniformSet>>& frames, const bool elide)
+{
+    UniformCache::setRedundantUploadElision(elide);
+    RunResult result;
+
+    // Counted and checked frame by frame
+    std::vector<FakeProgram> programs = makePrograms(scenario);
+    for (const std::vector<UniformSet>& calls : frames)
+    {
+        replay(programs, calls);
+        result.consistent &= std::all_of(programs.begin(), programs.end(),
+                                         [](const FakeProgram& program) { return program.consistent(); });
+    }
+    uint64_t setCalls = 0, driverCalls = 0;
+    for (const FakeProgram& program : programs)
+    {
+        setCalls += program.setCalls;
+        driverCalls += program.driverCalls;
+    }
+    result.setCallsPerFrame = static_cast<double>(setCalls) / scenario.frames;
+    result.driverCallsPerFrame = static_cast<double>(driverCalls) / scenario.frames;
+
+    // Timed over all frames at once
+    for (int r = 0; r < RUNS; r++)
+    {
+        programs = makePrograms(scenario);
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::vector<UniformSet>& calls : frames)
+        {
+            replay(programs, calls);
+        }
+        const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        result.nsPerSetCall = std::min(result.nsPerSetCall, ns / static_cast<double>(setCalls));
+    }
+    return result;
+}
+
+int main()
+{
+    std::cout << std::fixed;
+    bool consistent = true;
+    for (const Scenario& scenario : scenarios())
+    {
+        std::vector<std::vector<UniformSet>> frames(scenario.frames);
+        for (int frame = 0; frame < scenario.frames; frame++)
+        {
+            FrameRecorder recorder(frames[frame]);
+            scenario.frame(recorder, frame);
+        }
+
+        const RunResult cached = run(scenario, frames, true);
+        const RunResult uncached = run(scenario, frames, false);
+        consistent &= cached.consistent && uncached.consistent;
+
+        std::cout << scenario.name << " (" << std::setprecision(0) << cached.setCallsPerFrame << " set calls per frame)\n"
+                  << "  driver calls per frame: " << std::setprecision(2) << cached.driverCallsPerFrame
+                  << " with the cache, " << uncached.driverCallsPerFrame << " without ("
+                  << std::setprecision(1) << 100.0 * (1.0 - cached.driverCallsPerFrame / uncached.driverCallsPerFrame)
+                  << "% skipped)\n"
+                  << "  per set call: " << std::setprecision(2) << cached.nsPerSetCall << " ns with the cache, "
+                  << uncached.nsPerSetCall << " ns without" << (cached.consistent && uncached.consistent ? "" : " MISMATCH")
+                  << "\n";
+    }
+    return consistent ? 0 : 1;
+}
@@ -1,9 +1,26 @@
+#include <cstddef>
+#include <optional>
 #include <vector>
 
 #include "shader.hpp"
 #include "opengl_object.hpp"
+#include "instanced_object.hpp"
+#include "vertex_layout.hpp"
+#include "mesh.hpp"
+#include "mesh_quantization.hpp"
+#include "mesh_welding.hpp"
+#include "mesh_optimizer.hpp"
 #include "window.hpp"  // Also includes glad and GLFW
 #include "camera.hpp"
+#include "command_line.hpp"
+#include "frame_data.hpp"
+#include "fixed_step_simulation.hpp"
+#include "frustum.hpp"
+#include "gl_state.hpp"
+#include "input_latency.hpp"
+#include "render_queue.hpp"
+#include "texture_binding.hpp"
+#include "texture_loader.hpp"
 
 #include "ext/glm/glm.hpp"
 #include "ext/glm/gtc/matrix_transform.hpp"
@@ -14,17 +31,91 @@
 
 #define INFO_LOG_BUFFER_SIZE 512
 
-struct TextureData
+// Stress mode draws a large grid of rotating cubes to measure draw submission cost.
+// Run with `--stress` for the instanced path or `--stress --naive` for one draw per cube. `--stress --naive
+// --queue` records the draws on all cores into a render queue and submits them front to back.
+constexpr int STRESS_GRID_X = 50;
+constexpr int STRESS_GRID_Y = 50;
+constexpr int STRESS_GRID_Z = 40;
+constexpr int STRESS_CUBE_COUNT = STRESS_GRID_X * STRESS_GRID_Y * STRESS_GRID_Z; // 100k cubes
+constexpr float STRESS_CUBE_SPACING = 2.0f;
+
+// Dense mode draws a grid of high-poly spheres to measure vertex fetch cost.
+// Run with `--dense` for 32 byte float vertices or `--dense --quantized` for 16 byte quantized ones.
+constexpr int DENSE_GRID_SIZE = 10;
+constexpr uint DENSE_SPHERE_SEGMENTS = 256;
+constexpr uint DENSE_SPHERE_RINGS = 128;
+
+// Texture bytes streamed to the GPU per frame at most, the rest waits for the next frames
+constexpr size_t TEXTURE_UPLOAD_BUDGET = 8 << 20;
+
+// Steps per second of the `--fixed-step` simulation thread
+constexpr double SIMULATION_RATE = 60.0;
+
+// Layers of the material texture array
+constexpr int CONTAINER_LAYER = 0;
+constexpr int FACE_LAYER = 1;
+
+// Position + half precision texture coordinates: 16 bytes per vertex instead of 20 as plain floats
+struct TexturedVertex
 {
-    uint textureId;
-    GLenum textureUnit;
-    const char* uniformName;
+    glm::vec3 position;
+    Half2::Storage uv;
 };
 
-void initTexture(uint* textureId, const char* imagePath, GLenum imageColourFormat);
-inline void processKeyboardInput(GLFWwindow *window);
+// What the simulation thread moves with `--fixed-step`: the camera position, the animation clock and
+// the model matrices of the stress and dense scene objects at that time. The camera is turned by the
+// mouse on the render thread, so looking around isn't delayed by a step.
+struct SceneState
+{
+    glm::vec3 cameraPosition;
+    double time;
+    std::vector<glm::mat4> models;
+};
+
+struct SceneInput
+{
+    uint movementKeys = 0; // Bit per CameraMovement held down
+    glm::vec3 front{0.0f};
+    glm::vec3 right{0.0f};
+    float speed = 0.0f;
+};
+
+using TexturedLayout = VertexLayout<Attr<Position, Float3>, Attr<UV, Half2>>;
+static_assert(TexturedLayout::matches<TexturedVertex, &TexturedVertex::position, &TexturedVertex::uv>());
+
+std::vector<TexturedVertex> toTexturedVertices(const std::vector<float>& vertices);
+inline void processKeyboardInput(GLFWwindow *window, bool moveCamera);
+uint heldMovementKeys(GLFWwindow* window);
+void stepScene(SceneState& state, const SceneInput& input, double step);
+glm::mat4 interpolateModel(const glm::mat4& from, const glm::mat4& to, double alpha);
 void mouseCallback(GLFWwindow* window, double xPos, double yPos);
 void scrollCallback(GLFWwindow *, double, double yOffset);
+void pollInput();
+void initDenseScene(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colours);
+void initStressScene(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colours);
+glm::mat4 stressModel(const glm::vec3& position, size_t index, float time);
+void updateStressModels(const std::vector<glm::vec3>& positions, float time, std::vector<glm::mat4>& models);
+template <typename Model>
+void updateVisibleModels(const std::vector<uint>& visible, size_t visibleCount, Model model,
+                         std::vector<glm::mat4>& models);
+
+// Submits the packets of the queued stress mode, which all use the same program and material
+struct StressDrawBackend
+{
+    const Shader& shader;
+    const UniformHandle modelUniform;
+    const OpenGLObject& cube;
+
+    void bindLayer(uint) {}
+    void bindProgram(uint) { shader.use(); }
+    void bindMaterial(uint) {}
+    void draw(const DrawPacket& packet)
+    {
+        shader.setMat4(modelUniform, glm::value_ptr(*static_cast<const glm::mat4*>(packet.data)));
+        cube.draw();
+    }
+};
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = WINDOW_WIDTH / 2.0f;
@@ -32,9 +123,26 @@ float lastY = WINDOW_HEIGHT / 2.0f;
 bool firstMouse = true;
 float deltaTime = 0.0f;   // Time between the current frame and last frame
 float lastFrame = 0.0f;
+double inputSampleTime = 0.0; // When the input the camera reflects was last polled
 
-int main()
+int main(int argc, char** argv)
 {
+    const bool stressMode = hasFlag(argc, argv, "--stress");
+    const bool naiveStress = stressMode && hasFlag(argc, argv, "--naive");
+    const bool queuedStress = naiveStress && hasFlag(argc, argv, "--queue");
+    const bool denseMode = !stressMode && hasFlag(argc, argv, "--dense");
+    const bool quantizedDense = denseMode && hasFlag(argc, argv, "--quantized");
+    // `--low-latency` polls input right before the camera is used instead of after the previous swap,
+    // `--late-latch` also polls again and patches the camera just before the draws are submitted
+    const bool lateLatch = hasFlag(argc, argv, "--late-latch");
+    const bool lowLatency = lateLatch || hasFlag(argc, argv, "--low-latency");
+    const bool reportLatency = lowLatency || hasFlag(argc, argv, "--latency");
+    // `--fixed-step` moves the camera and animates the scene at a fixed rate on a separate thread
+    const bool fixedStep = hasFlag(argc, argv, "--fixed-step");
+    // `--validate-gl-state` checks the GL state cache against the driver, every frame and on every elided call
+    const bool validateGLState = hasFlag(argc, argv, "--validate-gl-state");
+    glState().setValidation(validateGLState);
+
     const std::vector rectVertices = {
         // positions       // texture coords
          0.5f,  0.5f, 0.0f, 1.0f, 1.0f, // top right
@@ -112,90 +220,305 @@ int main()
         0.4f, -0.5f, 0.0f, 1.0f, 0.0f, // right
     };
 
-    const std::vector<VBOConfig> vboConfig = {
-        {0, 3}, // Position
-        {1, 2}, // 2D Texture Coords
-    };
-
     std::cout << "Running program...\n";
     GLFWwindow* window;
     initWindow(&window);
 
+    // The 36 cube vertices only have 24 unique position/texture coordinate combinations
+    WeldedMesh<TexturedVertex> cube = weldVertices(toTexturedVertices(cubeVertices));
+    optimizeMesh(cube.vertices, cube.indices);
+
     const std::vector objects = {
-        // OpenGLObject(triangleVertices, vboConfig)
-        // OpenGLObject(rectVertices, indices, vboConfig),
-        OpenGLObject(cubeVertices, vboConfig),
+        // OpenGLObject(toTexturedVertices(triangleVertices), TexturedLayout{}),
+        // OpenGLObject(toTexturedVertices(rectVertices), indices, TexturedLayout{}),
+        OpenGLObject(cube.vertices, cube.indices, TexturedLayout{}),
     };
 
     const auto shader = Shader("shaders/shader.vert", "shaders/shader.frag");
-
-    uint containerTex, faceTex;
-    initTexture(&containerTex, "textures/container.jpg", GL_RGB);
-    initTexture(&faceTex, "textures/awesome_face.png", GL_RGBA);
-    // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-
-    const std::vector<TextureData> textures = {
-        {containerTex, GL_TEXTURE0, "texture1"},
-        {faceTex, GL_TEXTURE1, "texture2"},
-    };
-
-    // We currently only have one shader, so we can set it
-    // as the active shader outside the render loop
-    shader.use();
-
-    for (int i = 0; i < textures.size(); i++)
+    const auto instancedShader = Shader("shaders/instanced.vert", "shaders/instanced.frag");
+    auto instancedCube = InstancedOpenGLObject(cube.vertices, cube.indices, TexturedLayout{}, true);
+
+    std::vector<glm::vec3> stressPositions;
+    std::vector<glm::mat4> stressModels;
+    std::vector<glm::vec3> stressColours, visibleColours;
+    BoundingSpheres stressBounds;
+    std::vector<uint> visibleCubes;
+    if (stressMode)
     {
-        shader.setInt(textures[i].uniformName, i);
+        initStressScene(stressPositions, stressColours);
+        // A unit cube rotating about its centre always stays within this sphere
+        for (const glm::vec3& position : stressPositions)
+        {
+            stressBounds.add(position, glm::sqrt(3.0f) / 2.0f);
+        }
+        std::cout << "Stress mode: " << STRESS_CUBE_COUNT << " cubes, "
+                  << (naiveStress ? "one draw call per cube" : "one instanced draw call")
+                  << (queuedStress ? ", recorded into a render queue" : "") << "\n";
     }
 
-    for (const TextureData t : textures)
+    std::optional<InstancedOpenGLObject> denseSphere;
+    glm::mat4 denseDequantization(1.0f);
+    if (denseMode)
     {
-        glActiveTexture(t.textureUnit);
-        glBindTexture(GL_TEXTURE_2D, t.textureId);
-    }
+        std::vector<glm::vec3> denseColours;
+        initDenseScene(stressPositions, denseColours);
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    glfwSetCursorPosCallback(window, mouseCallback);
-    glEnable(GL_DEPTH_TEST);
+        FloatMesh sphere = generateSphere(DENSE_SPHERE_SEGMENTS, DENSE_SPHERE_RINGS);
+        optimizeMesh(sphere);
+        if (quantizedDense)
+        {
+            const QuantizedMesh quantized = quantizeMesh(sphere);
+            denseSphere.emplace(quantized.vertices, quantized.indices, QuantizedLayout{}, true);
+            denseDequantization = quantized.dequantization;
+            std::cout << "Quantized sphere: " << quantized.quantizedBytes << " vertex bytes instead of "
+                      << quantized.sourceBytes << ", max error: position " << quantized.error.position
+                      << ", uv " << quantized.error.uv << ", normal " << quantized.error.normalDegrees << " degrees\n";
+        }
+        else
+        {
+            denseSphere.emplace(interleave(sphere), sphere.indices, MeshLayout{}, true);
+        }
+        denseSphere->setInstanceColours(denseColours);
+        std::cout << "Dense mode: " << stressPositions.size() << " spheres of " << sphere.indices.size() / 3
+                  << " triangles each\n";
+    }
 
-    while (!glfwWindowShouldClose(window))
+    if (stressMode || denseMode)
     {
-        const auto currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        // Don't let vsync cap the frame rate we are trying to measure
+        glfwSwapInterval(0);
+    }
 
-        processKeyboardInput(window);
+    // Everything that deletes GL objects when it goes out of scope lives in this block, so that it
+    // is gone before glfwTerminate() destroys the context
+    {
+        // Textures show a placeholder until their images are decoded in the background. Both
+        // materials are 512x512, so they are layers of one texture array: a single bind covers every
+        // draw, which picks its layers through uniforms.
+        TextureLoader textureLoader;
+        const uint materials = textureLoader.loadArray({"textures/container.jpg", "textures/awesome_face.png"});
+        // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+        // Both shaders sample the same texture unit and layers, so their uniforms only need to be set once
+        for (const Shader* s : {&instancedShader, &shader})
+        {
+            s->use();
+            s->setInt("materials", 0);
+            s->setInt("baseLayer", CONTAINER_LAYER);
+            s->setInt("overlayLayer", FACE_LAYER);
+        }
 
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Outside of the instanced stress mode there is only one active shader,
+        // so we can set it outside the render loop
+        const Shader& activeShader = (stressMode && !naiveStress) || denseMode ? instancedShader : shader;
+        activeShader.use();
+
+        auto frameData = FrameUniformBuffer();
+        const UniformHandle modelUniform = shader.getUniform("model");
+
+        // Every draw samples the materials with the same trilinear, anisotropic sampler
+        SamplerCache samplers;
+        SamplerState materialSampling;
+        materialSampling.maxAnisotropy = 8.0f;
+        const uint materialSampler = samplers.get(materialSampling);
+
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwSetCursorPosCallback(window, mouseCallback);
+        glState().enable(GL_DEPTH_TEST);
+        camera.setAspectRatio(static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT));
+
+        InputLatencyMeter latencyMeter;
+        RenderQueue renderQueue;
+        // Model matrices of the stress and dense scene objects at a point in time
+        const auto animateObjects = [&](const float time, std::vector<glm::mat4>& models) {
+            updateStressModels(stressPositions, time, models);
+            if (denseMode)
+            {
+                // Quantized positions are decoded relative to the sphere's bounding box
+                for (glm::mat4& model : models)
+                {
+                    model *= denseDequantization;
+                }
+            }
+        };
 
-        glm::mat4 view = camera.getViewMatrix();
+        std::optional<FixedStepSimulation<SceneState, SceneInput>> simulation;
+        if (fixedStep)
+        {
+            // The simulation thread animates every object each step, the render thread only interpolates
+            // the ones it draws
+            SceneState initial{camera.getPosition(), glfwGetTime(), {}};
+            animateObjects(static_cast<float>(initial.time), initial.models);
+            simulation.emplace(initial, SIMULATION_RATE, [&](SceneState& state, const SceneInput& input, const double step) {
+                stepScene(state, input, step);
+                animateObjects(static_cast<float>(state.time), state.models);
+            });
+        }
+        int framesSinceReport = 0;
+        float lastReport = static_cast<float>(glfwGetTime());
 
-        auto projection =
-            glm::perspective(glm::radians(45.0f),
-                             static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT),
-                             0.1f,
-                             100.0f);
+        while (!glfwWindowShouldClose(window))
+        {
+            const auto currentFrame = static_cast<float>(glfwGetTime());
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
 
-        shader.setMat4("view", glm::value_ptr(view));
-        shader.setMat4("projection", glm::value_ptr(projection));
+            framesSinceReport++;
+            if ((stressMode || denseMode || reportLatency) && currentFrame - lastReport >= 1.0f)
+            {
+                const float elapsed = currentFrame - lastReport;
+                const UniformUploadStats& stats = Shader::uploadStats();
+                const GLStateStats& stateStats = glState().stats();
+                std::cout << "Average frame time: " << 1000.0f * elapsed / static_cast<float>(framesSinceReport)
+                          << " ms (" << static_cast<float>(framesSinceReport) / elapsed << " FPS), "
+                          << stats.uploads / framesSinceReport << " uniform uploads and "
+                          << stats.elided / framesSinceReport << " elided per frame, "
+                          << stateStats.calls / framesSinceReport << " GL state calls and "
+                          << stateStats.elided / framesSinceReport << " elided per frame\n";
+                if (reportLatency)
+                {
+                    const InputLatencyStats latency = latencyMeter.stats();
+                    std::cout << "Input latency: " << latency.averageMs << " ms average, " << latency.maxMs << " ms max over "
+                              << latency.frames << " frames\n";
+                }
+                Shader::resetUploadStats();
+                glState().resetStats();
+                latencyMeter.resetStats();
+                framesSinceReport = 0;
+                lastReport = currentFrame;
+            }
 
-        for (int i = 0; i < 10; i++)
-        {
-            auto model = glm::mat4(1.0f);
-            model = glm::translate(model, cubePositions[i]);
-            const float angle = 20.0f * static_cast<float>(i + 1);
-            model = glm::rotate(model, static_cast<float>(glfwGetTime()) * glm::radians(angle),
-                                glm::vec3(0.5f, 1.0f, 0.0f));
-            shader.setMat4("model", glm::value_ptr(model));
-            for (const OpenGLObject& object : objects)
+            if (lowLatency)
+                pollInput();
+            processKeyboardInput(window, !simulation);
+            // Time the scene is animated at
+            float animationTime = currentFrame;
+            std::optional<SimulationSample<SceneState>> steps;
+            if (simulation)
             {
-                object.draw();
+                simulation->setInput({heldMovementKeys(window), camera.getFront(), camera.getRight(), camera.getMovementSpeed()});
+                steps.emplace(simulation->sampleSteps());
+                camera.setPosition(glm::mix(steps->from.cameraPosition, steps->to.cameraPosition, static_cast<float>(steps->alpha)));
+                animationTime = static_cast<float>(steps->from.time + (steps->to.time - steps->from.time) * steps->alpha);
+            }
+            // The model matrix of stress or dense object i this frame
+            const auto objectModel = [&](const uint i) {
+                return steps ? interpolateModel(steps->from.models[i], steps->to.models[i], steps->alpha)
+                             : stressModel(stressPositions[i], i, animationTime);
+            };
+            textureLoader.pump(SIZE_MAX, TEXTURE_UPLOAD_BUDGET);
+
+            // Only the first frame reaches GL, the binding never changes
+            glState().bindTexture(0, GL_TEXTURE_2D_ARRAY, materials);
+            glState().bindSampler(0, materialSampler);
+
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            frameData.update(camera, animationTime);
+
+            // Mouse movement since the update above turns the camera for this frame's draws. Everything
+            // that only needs to reach the GPU before them, like instance data, is done by then. Culling
+            // still uses the earlier camera, so cubes entering the view at its edges can show up a frame late.
+            const auto latchInput = [&] {
+                if (!lateLatch)
+                    return;
+                pollInput();
+                frameData.updateCamera(camera);
+            };
+
+            if (denseMode)
+            {
+                if (steps)
+                {
+                    stressModels.resize(stressPositions.size());
+                    for (uint i = 0; i < stressPositions.size(); i++)
+                    {
+                        stressModels[i] = objectModel(i);
+                    }
+                }
+                else
+                {
+                    animateObjects(animationTime, stressModels);
+                }
+                denseSphere->setInstances(stressModels);
+                latchInput();
+                denseSphere->draw();
+            }
+            else if (stressMode)
+            {
+                const Frustum frustum = Frustum::fromMatrix(frameData.data().viewProj);
+                const size_t visibleCount = cullSpheres(frustum, stressBounds, visibleCubes);
+                if (queuedStress)
+                {
+                    // The worker threads animate the visible cubes and record a draw for each. The camera
+                    // isn't thread safe, they get a copy of its view matrix to sort by distance with.
+                    const glm::mat4 view = camera.getViewMatrix();
+                    stressModels.resize(visibleCount);
+                    renderQueue.clear();
+                    renderQueue.record(visibleCount, [&](DrawRecorder& recorder, const size_t begin, const size_t end) {
+                        for (size_t v = begin; v < end; v++)
+                        {
+                            const uint i = visibleCubes[v];
+                            stressModels[v] = objectModel(i);
+                            recorder.push(makeSortKey(0, 0, 0, sortKeyDepth(-(view * stressModels[v][3]).z)), &stressModels[v]);
+                        }
+                    });
+                    renderQueue.sort();
+                    latchInput();
+                    StressDrawBackend backend{shader, modelUniform, objects[0]};
+                    renderQueue.submit(backend);
+                }
+                else if (naiveStress)
+                {
+                    updateVisibleModels(visibleCubes, visibleCount, objectModel, stressModels);
+                    latchInput();
+                    for (const glm::mat4& model : stressModels)
+                    {
+                        shader.setMat4(modelUniform, glm::value_ptr(model));
+                        objects[0].draw();
+                    }
+                }
+                else
+                {
+                    updateVisibleModels(visibleCubes, visibleCount, objectModel, stressModels);
+                    // Instances are compacted by culling, so their colours have to follow
+                    visibleColours.resize(visibleCount);
+                    for (size_t v = 0; v < visibleCount; v++)
+                    {
+                        visibleColours[v] = stressColours[visibleCubes[v]];
+                    }
+                    instancedCube.setInstanceColours(visibleColours);
+                    instancedCube.setInstances(stressModels);
+                    latchInput();
+                    instancedCube.draw();
+                }
+            }
+            else
+            {
+                latchInput();
+                for (int i = 0; i < 10; i++)
+                {
+                    auto model = glm::mat4(1.0f);
+                    model = glm::translate(model, cubePositions[i]);
+                    const float angle = 20.0f * static_cast<float>(i + 1);
+                    model = glm::rotate(model, animationTime * glm::radians(angle),
+                                        glm::vec3(0.5f, 1.0f, 0.0f));
+                    shader.setMat4(modelUniform, glm::value_ptr(model));
+                    for (const OpenGLObject& object : objects)
+                    {
+                        object.draw();
+                    }
+                }
             }
-        }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+            if (validateGLState)
+                glState().validate();
+            latencyMeter.frameSubmitted(inputSampleTime);
+            glfwSwapBuffers(window);
+            if (!lowLatency)
+                pollInput();
+        }
     }
 
     glfwTerminate();
@@ -203,34 +526,95 @@ int main()
     return 0;
 }
 
-void initTexture(uint* textureId, const char* imagePath, const GLenum imageColourFormat)
+std::vector<TexturedVertex> toTexturedVertices(const std::vector<float>& vertices)
 {
-    int width, height, channels;
+    // Interleaved as 3 position floats followed by 2 texture coordinate floats
+    std::vector<TexturedVertex> texturedVertices(vertices.size() / 5);
+    for (size_t i = 0; i < texturedVertices.size(); i++)
+    {
+        const float* vertex = &vertices[i * 5];
+        texturedVertices[i].position = glm::vec3(vertex[0], vertex[1], vertex[2]);
+        texturedVertices[i].uv = Half2::pack(glm::vec2(vertex[3], vertex[4]));
+    }
+    return texturedVertices;
+}
 
-    // OpenGL expects the (0,0) coordinate of an image to be on the bottom-left,
-    // but usually in images it is on the top left. Flipping the image vertically
-    // will make OpenGL render it in the intended orientation.
-    stbi_set_flip_vertically_on_load(true);
+// Runs the event callbacks, which move the camera, and remembers when
+void pollInput()
+{
+    glfwPollEvents();
+    inputSampleTime = glfwGetTime();
+}
 
-    unsigned char* data = stbi_load(imagePath, &width, &height, &channels, 0);
+void initDenseScene(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colours)
+{
+    // A square wall of spheres facing the camera
+    for (int x = 0; x < DENSE_GRID_SIZE; x++)
+    {
+        for (int y = 0; y < DENSE_GRID_SIZE; y++)
+        {
+            positions.emplace_back(
+                (static_cast<float>(x) - DENSE_GRID_SIZE / 2.0f) * 2.5f,
+                (static_cast<float>(y) - DENSE_GRID_SIZE / 2.0f) * 2.5f,
+                -20.0f);
+            colours.emplace_back(1.0f);
+        }
+    }
+}
+
+void initStressScene(std::vector<glm::vec3>& positions, std::vector<glm::vec3>& colours)
+{
+    positions.reserve(STRESS_CUBE_COUNT);
+    colours.reserve(STRESS_CUBE_COUNT);
 
-    if (!data)
+    // Lay the cubes out in a grid centred on the x and y axes, stretching away from the camera
+    for (int x = 0; x < STRESS_GRID_X; x++)
     {
-        std::cout << "Failed to load texture at: " << imagePath << std::endl;
-        stbi_image_free(data);
-        exit(1);
+        for (int y = 0; y < STRESS_GRID_Y; y++)
+        {
+            for (int z = 0; z < STRESS_GRID_Z; z++)
+            {
+                positions.emplace_back(
+                    (static_cast<float>(x) - STRESS_GRID_X / 2.0f) * STRESS_CUBE_SPACING,
+                    (static_cast<float>(y) - STRESS_GRID_Y / 2.0f) * STRESS_CUBE_SPACING,
+                    -static_cast<float>(z + 2) * STRESS_CUBE_SPACING);
+                colours.emplace_back(
+                    static_cast<float>(x) / STRESS_GRID_X,
+                    static_cast<float>(y) / STRESS_GRID_Y,
+                    1.0f - static_cast<float>(z) / STRESS_GRID_Z);
+            }
+        }
     }
+}
 
-    glGenTextures(1, textureId);
-    glBindTexture(GL_TEXTURE_2D, *textureId);
+// Builds the model matrices of every object
+void updateStressModels(const std::vector<glm::vec3>& positions, const float time, std::vector<glm::mat4>& models)
+{
+    models.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        models[i] = stressModel(positions[i], i, time);
+    }
+}
 
-    // Set the texture wrapping/filtering options (on currently bound texture)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+// Builds the model matrices of the visible objects only, from the first visibleCount indices in
+// visible, with model(index)
+template <typename Model>
+void updateVisibleModels(const std::vector<uint>& visible, const size_t visibleCount, Model model,
+                         std::vector<glm::mat4>& models)
+{
+    models.resize(visibleCount);
+    for (size_t v = 0; v < visibleCount; v++)
+    {
+        models[v] = model(visible[v]);
+    }
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, imageColourFormat, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    stbi_image_free(data);
+glm::mat4 stressModel(const glm::vec3& position, const size_t index, const float time)
+{
+    const float angle = 20.0f * static_cast<float>(index % 10 + 1);
+    const auto model = glm::translate(glm::mat4(1.0f), position);
+    return glm::rotate(model, time * glm::radians(angle), glm::vec3(0.5f, 1.0f, 0.0f));
 }
 
 void mouseCallback(GLFWwindow *, const double xPos, const double yPos)
@@ -257,10 +641,13 @@ void scrollCallback(GLFWwindow *, const double, const double yOffset)
     camera.processMouseScroll(static_cast<float>(yOffset));
 }
 
-inline void processKeyboardInput(GLFWwindow *window)
+// moveCamera is false when the simulation thread moves the camera
+inline void processKeyboardInput(GLFWwindow *window, const bool moveCamera)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
+    if (!moveCamera)
+        return;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         camera.processKeyboard(CameraMovement::Forward, deltaTime);
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
@@ -272,3 +659,45 @@ inline void processKeyboardInput(GLFWwindow *window)
 
 }
 
+constexpr uint movementBit(const CameraMovement movement)
+{
+    return 1u << static_cast<uint>(movement);
+}
+
+uint heldMovementKeys(GLFWwindow* window)
+{
+    uint keys = 0;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        keys |= movementBit(CameraMovement::Forward);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        keys |= movementBit(CameraMovement::Backward);
+    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        keys |= movementBit(CameraMovement::Left);
+    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        keys |= movementBit(CameraMovement::Right);
+    return keys;
+}
+
+// Runs on the simulation thread, moves the camera like Camera::processKeyboard
+void stepScene(SceneState& state, const SceneInput& input, const double step)
+{
+    const float distance = input.speed * static_cast<float>(step);
+    if (input.movementKeys & movementBit(CameraMovement::Forward))
+        state.cameraPosition += input.front * distance;
+    if (input.movementKeys & movementBit(CameraMovement::Backward))
+        state.cameraPosition -= input.front * distance;
+    if (input.movementKeys & movementBit(CameraMovement::Left))
+        state.cameraPosition -= input.right * distance;
+    if (input.movementKeys & movementBit(CameraMovement::Right))
+        state.cameraPosition += input.right * distance;
+    state.time += step;
+}
+
+// Blends two model matrices of an object a step apart. Cubes turn at most a few degrees per step, so
+// blending the matrices element by element shrinks them by well under a thousandth on the way.
+glm::mat4 interpolateModel(const glm::mat4& from, const glm::mat4& to, const double alpha)
+{
+    const auto a = static_cast<float>(alpha);
+    return from + (to - from) * a;
+}
+
@@ -0,0 +1,15 @@
+#version 330 core
+
+out vec4 fragColour;
+
+in vec3 vertexColour;
+in vec2 texCoord;
+
+uniform sampler2DArray materials;
+uniform int baseLayer;
+uniform int overlayLayer;
+
+void main() {
+    fragColour = mix(texture(materials, vec3(texCoord, baseLayer)),
+                     texture(materials, vec3(texCoord, overlayLayer)), 0.2) * vec4(vertexColour, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texCoordIn;
+layout (location = 4) in mat4 instanceModel;  // Occupies locations 4-7
+layout (location = 8) in vec3 instanceColour;
+
+out vec3 vertexColour;
+out vec2 texCoord;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPosition;
+    float time;
+};
+
+void main() {
+    gl_Position = viewProj * (instanceModel * vec4(position, 1.0));
+    vertexColour = instanceColour;
+    texCoord = texCoordIn;
+}
\ No newline at end of file
@@ -5,10 +5,11 @@ out vec4 fragColour;
 in vec3 vertexColour;
 in vec2 texCoord;
 
-uniform sampler2D texture1;
-uniform sampler2D texture2;
+uniform sampler2DArray materials;
+uniform int baseLayer;
+uniform int overlayLayer;
 
 void main() {
-    fragColour = mix(texture(texture1, texCoord),
-                     texture(texture2, texCoord), 0.2);
+    fragColour = mix(texture(materials, vec3(texCoord, baseLayer)),
+                     texture(materials, vec3(texCoord, overlayLayer)), 0.2);
 }
\ No newline at end of file
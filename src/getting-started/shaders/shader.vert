@@ -6,11 +6,17 @@ out vec3 vertexColour;
 out vec2 texCoord;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPosition;
+    float time;
+};
 
 void main() {
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    gl_Position = viewProj * (model * vec4(position, 1.0));
 //    gl_Position = vec4(position, 1.0);
     vertexColour = vec3(1.0, 1.0, 1.0);
     texCoord = texCoordIn;
@@ -1,7 +1,12 @@
 #include "lighting.hpp"
 
 #include "camera.hpp"
-#include "opengl_object.hpp"
+#include "command_line.hpp"
+#include "frame_data.hpp"
+#include "geometry_pool.hpp"
+#include "gl_state.hpp"
+#include "input_latency.hpp"
+#include "mesh_welding.hpp"
 #include "shader.hpp"
 #include "window.hpp"
 
@@ -9,9 +14,11 @@
 #include "ext/glm/gtc/matrix_transform.hpp"
 #include "ext/glm/gtc/type_ptr.hpp"
 
+std::vector<PositionVertex> toPositionVertices(const std::vector<float>& vertices);
 void processKeyboardInput(GLFWwindow* window);
 void mouseCallback(GLFWwindow* window, double xPos, double yPos);
 void scrollCallback(GLFWwindow *, double, double yOffset);
+void pollInput();
 
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = WINDOW_WIDTH / 2.0f;
@@ -19,74 +26,149 @@ float lastY = WINDOW_HEIGHT / 2.0f;
 bool firstMouse = true;
 float deltaTime = 0.0f;   // Time between the current frame and last frame
 float lastFrame = 0.0f;
+double inputSampleTime = 0.0; // When the input the camera reflects was last polled
 
 glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
-int main()
+int main(int argc, char** argv)
 {
+    // Run with `--no-uniform-cache` to send every uniform upload to the driver for comparison
+    Shader::setRedundantUploadElision(!hasFlag(argc, argv, "--no-uniform-cache"));
+    // `--low-latency` polls input right before the camera is used instead of after the previous swap,
+    // `--late-latch` also polls again and patches the camera just before the draws are submitted
+    const bool lateLatch = hasFlag(argc, argv, "--late-latch");
+    const bool lowLatency = lateLatch || hasFlag(argc, argv, "--low-latency");
+    // `--validate-gl-state` checks the GL state cache against the driver, every frame and on every elided call
+    const bool validateGLState = hasFlag(argc, argv, "--validate-gl-state");
+    glState().setValidation(validateGLState);
+
     GLFWwindow* window;
     initWindow(&window);
 
-    const auto cube = OpenGLObject(cubeVertices, cubeVboConfigList);
+    // Every mesh with the position-only layout lives in the same buffers and shares one VAO
+    auto geometry = GeometryPool(PositionLayout{});
+    // Without texture coordinates the 36 cube vertices collapse into its 8 corners
+    const WeldedMesh<PositionVertex> cubeMesh = weldVertices(toPositionVertices(cubeVertices));
+    const PooledMesh cube = geometry.add(cubeMesh.vertices, cubeMesh.indices);
+    const PooledMesh light = geometry.add(cubeMesh.vertices, cubeMesh.indices);
+
+    const GeometryPoolStats geometryStats = geometry.stats();
+    std::cout << "Geometry pool: " << geometryStats.vertexBytesInUse << "/" << geometryStats.vertexBytesCapacity
+              << " vertex bytes and " << geometryStats.indexBytesInUse << "/" << geometryStats.indexBytesCapacity
+              << " index bytes in use, fragmentation " << geometryStats.vertexFragmentation << "/"
+              << geometryStats.indexFragmentation << "\n";
+
     const auto cubeShader = Shader("shaders/cube.vert", "shaders/cube.frag");
-    const auto light = OpenGLObject(cubeVertices, cubeVboConfigList);
     const auto lightShader = Shader("shaders/light.vert", "shaders/light.frag");
+    auto frameData = FrameUniformBuffer();
+
+    const UniformHandle cubeObjectColour = cubeShader.getUniform("objectColour");
+    const UniformHandle cubeLightColour = cubeShader.getUniform("lightColour");
+    const UniformHandle cubeModelUniform = cubeShader.getUniform("model");
+    const UniformHandle lightModelUniform = lightShader.getUniform("model");
 
     constexpr auto objectColour = glm::vec3(1.0f, 0.5f, 0.31f);
     constexpr auto lightColour = glm::vec3(1.0f, 1.0f, 1.0f);
 
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     glfwSetCursorPosCallback(window, mouseCallback);
-    glEnable(GL_DEPTH_TEST);
+    glState().enable(GL_DEPTH_TEST);
+    camera.setAspectRatio(static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT));
 
-    while (!glfwWindowShouldClose(window))
+    // The latency meter deletes its queries when it goes out of scope, which has to happen before
+    // glfwTerminate() destroys the context
     {
-        const auto currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        processKeyboardInput(window);
-
-        glm::mat4 view = camera.getViewMatrix();
-        auto projection =
-            glm::perspective(glm::radians(45.0f),
-                             static_cast<float>(WINDOW_WIDTH) / static_cast<float>(WINDOW_HEIGHT),
-                             0.1f,
-                             100.0f);
-        auto cubeModel = glm::mat4(1.0f);
-        cubeModel = glm::translate(cubeModel, glm::vec3(0.0f, 0.0f, 0.0f));
-
-        cubeShader.use();
-        cubeShader.setVec3("objectColour", glm::value_ptr(objectColour));
-        cubeShader.setVec3("lightColour", glm::value_ptr(lightColour));
-        cubeShader.setMat4("view", glm::value_ptr(view));
-        cubeShader.setMat4("projection", glm::value_ptr(projection));
-        cubeShader.setMat4("model", glm::value_ptr(cubeModel));
-
-        cube.draw();
-
-        auto lightModel = glm::mat4(1.0f);
-        lightModel = glm::translate(lightModel, lightPos);
-        lightModel = glm::scale(lightModel, glm::vec3(0.2f));
-
-        lightShader.use();
-        lightShader.setMat4("view", glm::value_ptr(view));
-        lightShader.setMat4("projection", glm::value_ptr(projection));
-        lightShader.setMat4("model", glm::value_ptr(lightModel));
-
-        light.draw();
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        InputLatencyMeter latencyMeter;
+        int framesSinceReport = 0;
+        float lastReport = static_cast<float>(glfwGetTime());
+
+        while (!glfwWindowShouldClose(window))
+        {
+            const auto currentFrame = static_cast<float>(glfwGetTime());
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            framesSinceReport++;
+            if (currentFrame - lastReport >= 1.0f)
+            {
+                const UniformUploadStats& stats = Shader::uploadStats();
+                const auto frames = static_cast<double>(framesSinceReport);
+                std::cout << "Uniform uploads per frame: " << static_cast<double>(stats.uploads) / frames
+                          << ", elided: " << static_cast<double>(stats.elided) / frames << "\n";
+                const GLStateStats& stateStats = glState().stats();
+                std::cout << "GL state calls per frame: " << static_cast<double>(stateStats.calls) / frames
+                          << ", elided: " << static_cast<double>(stateStats.elided) / frames << "\n";
+                const InputLatencyStats latency = latencyMeter.stats();
+                std::cout << "Input latency: " << latency.averageMs << " ms average, " << latency.maxMs << " ms max over "
+                          << latency.frames << " frames\n";
+                Shader::resetUploadStats();
+                glState().resetStats();
+                latencyMeter.resetStats();
+                framesSinceReport = 0;
+                lastReport = currentFrame;
+            }
+
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            if (lowLatency)
+                pollInput();
+            processKeyboardInput(window);
+
+            // One upload shared by both programs through the FrameData uniform block
+            frameData.update(camera, currentFrame);
+
+            geometry.bind();
+
+            auto cubeModel = glm::mat4(1.0f);
+            cubeModel = glm::translate(cubeModel, glm::vec3(0.0f, 0.0f, 0.0f));
+
+            // Mouse movement since the update above turns the camera for both draws
+            if (lateLatch)
+            {
+                pollInput();
+                frameData.updateCamera(camera);
+            }
+
+            cubeShader.use();
+            cubeShader.setVec3(cubeObjectColour, glm::value_ptr(objectColour));
+            cubeShader.setVec3(cubeLightColour, glm::value_ptr(lightColour));
+            cubeShader.setMat4(cubeModelUniform, glm::value_ptr(cubeModel));
+
+            geometry.draw(cube);
+
+            auto lightModel = glm::mat4(1.0f);
+            lightModel = glm::translate(lightModel, lightPos);
+            lightModel = glm::scale(lightModel, glm::vec3(0.2f));
+
+            lightShader.use();
+            lightShader.setMat4(lightModelUniform, glm::value_ptr(lightModel));
+
+            geometry.draw(light);
+
+            if (validateGLState)
+                glState().validate();
+            latencyMeter.frameSubmitted(inputSampleTime);
+            glfwSwapBuffers(window);
+            if (!lowLatency)
+                pollInput();
+        }
     }
 
     glfwTerminate();
     return 0;
 }
 
+std::vector<PositionVertex> toPositionVertices(const std::vector<float>& vertices)
+{
+    std::vector<PositionVertex> positionVertices(vertices.size() / 3);
+    for (size_t i = 0; i < positionVertices.size(); i++)
+    {
+        positionVertices[i].position = glm::vec3(vertices[i * 3], vertices[i * 3 + 1], vertices[i * 3 + 2]);
+    }
+    return positionVertices;
+}
+
 void processKeyboardInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -101,6 +183,13 @@ void processKeyboardInput(GLFWwindow *window)
         camera.processKeyboard(CameraMovement::Right, deltaTime);
 }
 
+// Runs the event callbacks, which move the camera, and remembers when
+void pollInput()
+{
+    glfwPollEvents();
+    inputSampleTime = glfwGetTime();
+}
+
 void mouseCallback(GLFWwindow *, const double xPos, const double yPos)
 {
     const auto x = static_cast<float>(xPos);
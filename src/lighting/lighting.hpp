@@ -1,7 +1,7 @@
 #pragma once
 #ifndef MAIN_HPP
 #include <vector>
-#include "opengl_object.hpp"
+#include "vertex_layout.hpp"
 
 const std::vector cubeVertices = {
     -0.5f, -0.5f, -0.5f,
@@ -47,20 +47,21 @@ const std::vector cubeVertices = {
     -0.5f,  0.5f, -0.5f,
 };
 
-const std::vector<VBOConfig> cubeVboConfigList = {
- {0, 3}, // Position
+// Both cubes only have positions
+struct PositionVertex
+{
+ glm::vec3 position;
 };
 
+using PositionLayout = VertexLayout<Attr<Position, Float3>>;
+static_assert(PositionLayout::matches<PositionVertex, &PositionVertex::position>());
+
 const std::vector triangleVertices = {
  // positions
  0.0f, -0.5f, 0.0f, // left
  0.2f, 0.5f, 0.0f,  // top
  0.4f, -0.5f, 0.0f, // right
 };
-
-const std::vector<VBOConfig> triangleVboConfigList = {
- {0, 3}, // Position
-};
 #define MAIN_HPP
 
 #endif //MAIN_HPP
@@ -3,9 +3,15 @@
 layout (location = 0) in vec3 position;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProj;
+    vec4 cameraPosition;
+    float time;
+};
 
 void main() {
-    gl_Position = projection * view * model * vec4(position, 1.0);
+    gl_Position = viewProj * (model * vec4(position, 1.0));
 }
\ No newline at end of file
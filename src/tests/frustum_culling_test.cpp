@@ -0,0 +1,198 @@
+// Checks every culling path the CPU supports, on one thread and on a WorkerPool, against the
+// scalar reference for a few cameras and object counts that exercise the SIMD tails. The SIMD
+// paths use FMA and a different order of operations, so an object may only land on the other
+// side when it is within rounding distance of a plane. Exits with 1 on any other difference.
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "frustum.hpp"
+
+#include "ext/glm/glm.hpp"
+#include "ext/glm/gtc/matrix_transform.hpp"
+
+struct Camera
+{
+    const char* name;
+    glm::mat4 viewProj;
+};
+
+int failures = 0;
+
+void fail(const std::string& message)
+{
+    std::cout << "FAILED: " << message << "\n";
+    failures++;
+}
+
+// Signed distance of the object to the frustum (negative outside) and the size of the terms that
+// went into it, computed in double
+template <typename Terms>
+bool nearBoundary(const Frustum& frustum, Terms terms)
+{
+    double margin = 1e30, magnitude = 0.0;
+    for (const glm::vec4& plane : frustum.planes)
+    {
+        double planeMagnitude;
+        const double distance = terms(plane, planeMagnitude);
+        if (distance < margin)
+        {
+            margin = distance;
+            magnitude = planeMagnitude;
+        }
+    }
+    return std::abs(margin) <= 1e-5 * (magnitude + 1.0);
+}
+
+template <typename IsBorderline>
+void compare(const std::string& name, const std::vector<uint>& expected, const size_t expectedCount,
+             const std::vector<uint>& actual, const size_t actualCount, const size_t objectCount,
+             IsBorderline isBorderline)
+{
+    std::vector<char> inExpected(objectCount, 0), inActual(objectCount, 0);
+    for (size_t v = 0; v < expectedCount; v++)
+    {
+        inExpected[expected[v]] = 1;
+    }
+    for (size_t v = 0; v < actualCount; v++)
+    {
+        if (actual[v] >= objectCount || (v > 0 && actual[v] <= actual[v - 1]))
+        {
+            fail(name + ": indices out of range or not ascending at " + std::to_string(v));
+            return;
+        }
+        inActual[actual[v]] = 1;
+    }
+    for (size_t i = 0; i < objectCount; i++)
+    {
+        if (inExpected[i] != inActual[i] && !isBorderline(i))
+        {
+            fail(name + ": object " + std::to_string(i) + (inActual[i] ? " visible" : " culled") +
+                 ", the reference disagrees");
+            return;
+        }
+    }
+}
+
+void testSpheres(const Camera& camera, const BoundingSpheres& spheres, WorkerPool& pool)
+{
+    const Frustum frustum = Frustum::fromMatrix(camera.viewProj);
+    std::vector<uint> expected, actual;
+    const size_t expectedCount = cullSpheresScalar(frustum, spheres, expected);
+    const auto isBorderline = [&](const size_t i) {
+        return nearBoundary(frustum, [&](const glm::vec4& plane, double& magnitude) {
+            const double terms[] = {double(plane.x) * spheres.x[i], double(plane.y) * spheres.y[i],
+                                    double(plane.z) * spheres.z[i], plane.w, spheres.radius[i]};
+            magnitude = std::abs(terms[0]) + std::abs(terms[1]) + std::abs(terms[2]) + std::abs(terms[3]) + std::abs(terms[4]);
+            return terms[0] + terms[1] + terms[2] + terms[3] + terms[4];
+        });
+    };
+
+    for (const CullingPath path : {CullingPath::SSE2, CullingPath::AVX2, CullingPath::AVX512})
+    {
+        if (!cullingPathSupported(path))
+            continue;
+        const std::string name = std::string("spheres ") + camera.name + " " + std::to_string(spheres.size()) + " " +
+                                 cullingPathName(path);
+        compare(name, expected, expectedCount, actual, cullSpheres(frustum, spheres, actual, path), spheres.size(),
+                isBorderline);
+        compare(name + " parallel", expected, expectedCount, actual, cullSpheres(frustum, spheres, actual, pool, path),
+                spheres.size(), isBorderline);
+    }
+}
+
+void testBoxes(const Camera& camera, const BoundingBoxes& boxes, WorkerPool& pool)
+{
+    const Frustum frustum = Frustum::fromMatrix(camera.viewProj);
+    std::vector<uint> expected, actual;
+    const size_t expectedCount = cullBoxesScalar(frustum, boxes, expected);
+    const auto isBorderline = [&](const size_t i) {
+        return nearBoundary(frustum, [&](const glm::vec4& plane, double& magnitude) {
+            const double terms[] = {double(plane.x) * boxes.x[i], double(plane.y) * boxes.y[i],
+                                    double(plane.z) * boxes.z[i], plane.w,
+                                    std::abs(double(plane.x)) * boxes.extentX[i],
+                                    std::abs(double(plane.y)) * boxes.extentY[i],
+                                    std::abs(double(plane.z)) * boxes.extentZ[i]};
+            double distance = 0.0;
+            magnitude = 0.0;
+            for (const double term : terms)
+            {
+                distance += term;
+                magnitude += std::abs(term);
+            }
+            return distance;
+        });
+    };
+
+    for (const CullingPath path : {CullingPath::SSE2, CullingPath::AVX2, CullingPath::AVX512})
+    {
+        if (!cullingPathSupported(path))
+            continue;
+        const std::string name = std::string("boxes ") + camera.name + " " + std::to_string(boxes.size()) + " " +
+                                 cullingPathName(path);
+        compare(name, expected, expectedCount, actual, cullBoxes(frustum, boxes, actual, path), boxes.size(),
+                isBorderline);
+        compare(name + " parallel", expected, expectedCount, actual, cullBoxes(frustum, boxes, actual, pool, path),
+                boxes.size(), isBorderline);
+    }
+}
+
+int main()
+{
+    const glm::mat4 perspective = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+    const Camera cameras[] = {
+        {"forward", perspective * glm::lookAt(glm::vec3(0.0f, 0.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f))},
+        {"oblique", perspective * glm::lookAt(glm::vec3(20.0f, -10.0f, 5.0f), glm::vec3(-3.0f, 4.0f, -30.0f),
+                                              glm::vec3(0.0f, 1.0f, 0.0f))},
+        {"orthographic", glm::ortho(-30.0f, 30.0f, -20.0f, 20.0f, 1.0f, 80.0f) *
+                             glm::lookAt(glm::vec3(0.0f, 50.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f))},
+    };
+
+    // Counts around the 4/8/16 lane widths and the parallel task size
+    const size_t counts[] = {0, 1, 7, 15, 17, 33, 1000, CULLING_TASK_SIZE + 5, 3 * CULLING_TASK_SIZE + 11};
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution position(-100.0f, 100.0f);
+    std::uniform_real_distribution size(0.0f, 4.0f);
+    WorkerPool pool(4);
+
+    for (const size_t count : counts)
+    {
+        BoundingSpheres spheres;
+        BoundingBoxes boxes;
+        for (size_t i = 0; i < count; i++)
+        {
+            const glm::vec3 centre(position(random), position(random), position(random));
+            spheres.add(centre, size(random));
+            boxes.add(centre, glm::vec3(size(random), size(random), size(random)));
+        }
+        for (const Camera& camera : cameras)
+        {
+            testSpheres(camera, spheres, pool);
+            testBoxes(camera, boxes, pool);
+        }
+    }
+
+    // Spheres touching a plane from either side, where rounding decides
+    for (const Camera& camera : cameras)
+    {
+        const Frustum frustum = Frustum::fromMatrix(camera.viewProj);
+        BoundingSpheres spheres;
+        for (int i = 0; i < 4096; i++)
+        {
+            const glm::vec4& plane = frustum.planes[i % 6];
+            const glm::vec3 normal(plane);
+            const glm::vec3 onPlane = glm::vec3(position(random), position(random), position(random));
+            const glm::vec3 projected = onPlane - normal * (glm::dot(normal, onPlane) + plane.w);
+            const float radius = size(random);
+            spheres.add(projected - normal * (radius + (i % 3 - 1) * 1e-4f), radius);
+        }
+        testSpheres(camera, spheres, pool);
+    }
+
+    std::cout << (failures == 0 ? "All culling paths match the reference" : "Culling paths disagree with the reference")
+              << " (best path: " << cullingPathName(cullingPath()) << ")\n";
+    return failures == 0 ? 0 : 1;
+}
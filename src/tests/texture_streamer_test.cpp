@@ -0,0 +1,209 @@
+// Drives TextureStreamer over a synthetic scene of baked 512x512 textures with a budget that only
+// fits part of it, through a backend that records levels instead of uploading them. After every
+// update() it checks that the resident bytes stay within the budget and agree with the levels the
+// backend holds, and that levels are loaded and evicted in order. The scene moves the camera
+// between textures so that levels have to be evicted, least recently used first. Exits with 1 on
+// any failure.
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "texture_streamer.hpp"
+
+constexpr int TEXTURE_COUNT = 12;
+constexpr int TEXTURE_SIZE = 512;
+constexpr size_t BUDGET_BYTES = 2 << 20;
+constexpr size_t UPLOAD_BYTES_PER_FRAME = 512 << 10;
+constexpr size_t LARGEST_LEVEL_BYTES = TEXTURE_SIZE * TEXTURE_SIZE * 4;
+
+int failures = 0;
+
+void check(const bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cout << "FAILED: " << message << "\n";
+        failures++;
+    }
+}
+
+// Stands in for GL: remembers which levels of each texture are defined
+struct RecordingBackend
+{
+    struct Texture
+    {
+        int base;                       // First defined level
+        std::vector<size_t> levelBytes; // 0 for undefined levels
+    };
+
+    std::map<uint, Texture> textures;
+    uint nextTexture = 1;
+    size_t uploadedBytes = 0;
+    bool inOrder = true; // Every load was right above the base level, every eviction the base level
+
+    uint create(const BakedTextureFile& file)
+    {
+        const auto levelCount = static_cast<int>(file.header().levelCount);
+        textures[nextTexture] = {levelCount, std::vector<size_t>(levelCount)};
+        return nextTexture++;
+    }
+
+    size_t loadLevel(const uint texture, const BakedTextureFile& file, const int level)
+    {
+        Texture& state = textures.at(texture);
+        inOrder &= level == state.base - 1;
+        state.base = level;
+        state.levelBytes[level] = file.level(static_cast<uint32_t>(level)).size;
+        uploadedBytes += state.levelBytes[level];
+        return state.levelBytes[level];
+    }
+
+    void evictLevel(const uint texture, const int level)
+    {
+        Texture& state = textures.at(texture);
+        inOrder &= level == state.base && state.levelBytes[level] > 0;
+        state.levelBytes[level] = 0;
+        state.base = level + 1;
+    }
+
+    void destroy(const uint texture) { textures.erase(texture); }
+
+    [[nodiscard]] size_t residentBytes() const
+    {
+        size_t bytes = 0;
+        for (const auto& [id, texture] : textures)
+        {
+            for (const size_t levelBytes : texture.levelBytes)
+            {
+                bytes += levelBytes;
+            }
+        }
+        return bytes;
+    }
+};
+
+using TestStreamer = BasicTextureStreamer<RecordingBackend>;
+
+// A baked RGBA texture with a full mip chain, contents don't matter
+std::string writeBakedTexture(const int index)
+{
+    std::vector<MipLevel> levels;
+    for (int size = TEXTURE_SIZE; size >= 1; size /= 2)
+    {
+        levels.push_back({size, size, std::vector<unsigned char>(static_cast<size_t>(size) * size * 4, index)});
+    }
+    const std::vector<unsigned char> file = bakeTexture(levels, 4, false);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() /
+                                       ("texture_streamer_test_" + std::to_string(index) + BAKED_TEXTURE_EXTENSION);
+    std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(file.data()), file.size());
+    return path.string();
+}
+
+// Runs one frame and checks what holds after every update()
+void frame(TestStreamer& streamer, const std::vector<uint>& handles, const std::vector<float>& screenSizes, int& frameIndex)
+{
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+        streamer.request(handles[i], screenSizes[i]);
+    }
+    const size_t uploadedBefore = streamer.backend().uploadedBytes;
+    streamer.update(frameIndex / 60.0);
+
+    const std::string at = " at frame " + std::to_string(frameIndex);
+    const TextureStreamingStats stats = streamer.stats();
+    const RecordingBackend& backend = streamer.backend();
+    check(stats.residentBytes <= BUDGET_BYTES, "resident bytes over the budget" + at);
+    check(stats.residentBytes == backend.residentBytes(), "resident bytes disagree with the backend" + at);
+    check(backend.inOrder, "levels loaded or evicted out of order" + at);
+    // At least one level goes up per frame, so the budget can be overshot by less than one level
+    check(backend.uploadedBytes - uploadedBefore < UPLOAD_BYTES_PER_FRAME + LARGEST_LEVEL_BYTES,
+          "per-frame upload budget exceeded" + at);
+    frameIndex++;
+}
+
+int main()
+{
+    TextureStreamingOptions options;
+    options.budgetBytes = BUDGET_BYTES;
+    options.uploadBytesPerFrame = UPLOAD_BYTES_PER_FRAME;
+    options.tailSize = 64;
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < TEXTURE_COUNT; i++)
+    {
+        paths.push_back(writeBakedTexture(i));
+    }
+
+    {
+        TestStreamer streamer(options);
+        std::vector<uint> handles(TEXTURE_COUNT);
+        for (int i = 0; i < TEXTURE_COUNT; i++)
+        {
+            check(streamer.add(paths[i].c_str(), &handles[i]), "add " + paths[i]);
+        }
+
+        // Only the tails, 64x64 and smaller, are loaded up front
+        const size_t tailBytes = streamer.stats().residentBytes;
+        check(tailBytes == streamer.backend().residentBytes(), "tail bytes disagree with the backend");
+        for (const uint handle : handles)
+        {
+            check(streamer.residentBase(handle) == 3, "texture added with more than its mip tail");
+        }
+        int frameIndex = 0;
+
+        // Close up to texture 0: it streams in level by level until it is complete
+        for (int i = 0; i < 10; i++)
+        {
+            frame(streamer, {handles[0]}, {static_cast<float>(TEXTURE_SIZE)}, frameIndex);
+        }
+        check(streamer.residentBase(handles[0]) == 0, "texture 0 not fully streamed in");
+        check(streamer.stats().evictions == 0, "evictions while the scene fits the budget");
+        check(streamer.stats().pendingRequests == 0, "requests pending while the scene fits the budget");
+
+        // Turn to textures 1 and 2. Both complete don't fit next to the tails, so texture 0, which
+        // nobody wants any more, is evicted down to its tail and one request stays pending.
+        for (int i = 0; i < 20; i++)
+        {
+            frame(streamer, {handles[1], handles[2]}, {static_cast<float>(TEXTURE_SIZE), static_cast<float>(TEXTURE_SIZE)}, frameIndex);
+        }
+        check(streamer.residentBase(handles[0]) == 3, "unused texture 0 not evicted to its tail");
+        check(streamer.stats().evictions == 3, "expected the three streamed levels of texture 0 to be evicted");
+        check(streamer.residentBase(handles[1]) + streamer.residentBase(handles[2]) == 1,
+              "expected one of textures 1 and 2 complete and the other missing only level 0");
+        check(streamer.stats().pendingRequests == 1, "expected the request that doesn't fit to stay pending");
+
+        // Step back so every texture covers 100 pixels: each wants the 128x128 level 2,
+        // floor(log2(512 / 100)). Everything fits once textures 1 and 2 give back their top levels.
+        // Runs past the first second, so the evictions per second are reported.
+        const std::vector<float> distant(TEXTURE_COUNT, 100.0f);
+        for (int i = 0; i < 40; i++)
+        {
+            frame(streamer, handles, distant, frameIndex);
+        }
+        for (int i = 0; i < TEXTURE_COUNT; i++)
+        {
+            check(streamer.residentBase(handles[i]) <= 2, "texture " + std::to_string(i) + " missing level 2");
+        }
+        check(streamer.stats().pendingRequests == 0, "requests pending although level 2 of everything fits");
+        check(streamer.stats().residentBytes <= tailBytes + TEXTURE_COUNT * (LARGEST_LEVEL_BYTES / 16) +
+                                                   2 * (LARGEST_LEVEL_BYTES + LARGEST_LEVEL_BYTES / 4),
+              "more resident than the wanted levels and what textures 1 and 2 may keep");
+        check(streamer.stats().evictionsPerSecond > 0.0f, "no evictions per second reported");
+
+        std::cout << "Resident " << streamer.stats().residentBytes << " of " << BUDGET_BYTES << " bytes after "
+                  << frameIndex << " frames, " << streamer.stats().evictions << " levels evicted\n";
+    }
+
+    for (const std::string& path : paths)
+    {
+        std::filesystem::remove(path);
+    }
+
+    std::cout << (failures == 0 ? "Texture streaming stays within its budget" : "Texture streaming checks failed")
+              << "\n";
+    return failures == 0 ? 0 : 1;
+}
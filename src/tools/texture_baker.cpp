@@ -0,0 +1,91 @@
+// Offline texture baker. Decodes an image once, generates its full mip chain and writes both to
+// a baked texture file (see baked_texture.hpp) that the runtime maps and uploads without decoding.
+//
+// Usage: texture_baker <input image> <output file> [--srgb] [--compress] [--rgba] [--kaiser] [--linear]
+// --srgb marks 3 and 4 channel images as sRGB encoded, so they are uploaded as GL_SRGB8(_ALPHA8).
+// --compress stores every level block compressed, BC4/BC5/BC1/BC3 for 1/2/3/4 channel images.
+// --rgba pads RGB images to RGBA, as TextureLoader does at runtime, so RGB and RGBA images bake to
+// the same format and can be layers of one texture array.
+// --kaiser filters the mips with a Kaiser windowed sinc instead of a box filter.
+// --linear filters colour channels as they are stored. By default they are taken to be sRGB encoded
+// and filtered in linear space, which --srgb implies as well.
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "baked_texture.hpp"
+#include "block_compression.hpp"
+#include "command_line.hpp"
+#include "mipmap_generator.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "ext/stb_image.h"
+
+int main(const int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cout << "Usage: " << argv[0] << " <input image> <output file> [--srgb] [--compress] [--rgba] [--kaiser] [--linear]" << std::endl;
+        return 1;
+    }
+    const char* inputPath = argv[1];
+    const char* outputPath = argv[2];
+    // Flags follow the two paths
+    const auto hasOption = [&](const char* flag) { return hasFlag(argc, argv, flag, 3); };
+    const bool srgb = hasOption("--srgb");
+    const bool compress = hasOption("--compress");
+    const MipOptions mipOptions{hasOption("--kaiser") ? MipFilter::Kaiser : MipFilter::Box, srgb || !hasOption("--linear"),
+                                std::max(1u, std::thread::hardware_concurrency())};
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Flipped like every other loader in the repo, so the baked texture is already in GL orientation
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, channels;
+    const bool padToRgba = hasOption("--rgba") && stbi_info(inputPath, &width, &height, &channels) && channels == 3;
+    unsigned char* pixels = stbi_load(inputPath, &width, &height, &channels, padToRgba ? 4 : 0);
+    if (pixels == nullptr)
+    {
+        std::cout << "Failed to load texture at: " << inputPath << std::endl;
+        return 1;
+    }
+    if (padToRgba)
+    {
+        channels = 4;
+    }
+
+    const std::vector<MipLevel> levels = generateMipChain(pixels, width, height, channels, mipOptions);
+    stbi_image_free(pixels);
+
+    std::vector<unsigned char> baked;
+    if (compress)
+    {
+        std::vector<CompressedImage> compressed;
+        for (const MipLevel& level : levels)
+        {
+            compressed.push_back(compressImage(level.pixels.data(), level.width, level.height, channels,
+                                               blockFormatFor(channels)));
+        }
+        baked = bakeCompressedTexture(compressed, channels, srgb);
+    }
+    else
+    {
+        baked = bakeTexture(levels, channels, srgb);
+    }
+
+    std::ofstream output(outputPath, std::ios::binary);
+    output.write(reinterpret_cast<const char*>(baked.data()), static_cast<std::streamsize>(baked.size()));
+    if (!output)
+    {
+        std::cout << "Failed to write baked texture to: " << outputPath << std::endl;
+        return 1;
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << inputPath << " -> " << outputPath << ": " << width << "x" << height << ", " << channels
+              << " channels, " << levels.size() << " levels, " << baked.size() / 1024 << " KiB in " << elapsedMs
+              << " ms\n";
+    return 0;
+}